@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Heap allocation accounting. The global operator new/delete hook is only compiled in
+// when CALC_COUNT_ALLOCATIONS is defined (Debug builds), otherwise every count stays zero.
+namespace allocations {
+
+    struct Counts {
+        size_t allocations = 0;
+        size_t bytes = 0;
+    };
+
+    constexpr bool enabled() {
+#ifdef CALC_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // totals for the calling thread since it started
+    Counts current();
+    // totals for all threads since the program started
+    Counts total();
+
+    class Operation {
+    private:
+        const char* name;
+        std::atomic<size_t> calls = 0;
+        std::atomic<size_t> allocationCount = 0;
+        std::atomic<size_t> byteCount = 0;
+    public:
+        explicit Operation(const char*);
+        void add(const Counts&);
+        const char* label() const;
+        double allocationsPerCall() const;
+        double bytesPerCall() const;
+    };
+
+    // attributes allocations made on this thread during its lifetime to an operation
+    class Scope {
+    private:
+        Operation& operation;
+        Counts start;
+    public:
+        explicit Scope(Operation&);
+        explicit Scope(const char*);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    Operation& operation(const char*);
+
+    // allocations of all threads between the last two calls
+    void endFrame();
+    Counts lastFrame();
+    std::vector<std::string> report();
+
+}
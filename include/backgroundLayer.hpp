@@ -0,0 +1,31 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include "textRenderer.hpp"
+
+// Grid, axes and their labels rendered once into a target texture and copied under the curves
+// each frame. The layer is redrawn only when the view or the output size changes.
+class BackgroundLayer {
+private:
+	SDL_Renderer* renderer;
+	TextRenderer& text;
+	SDL_Texture* texture = nullptr;
+	int width = 0;
+	int height = 0;
+	double minX = 0.0, maxX = 0.0, minY = 0.0, maxY = 0.0;
+	bool valid = false;
+
+	void render(double, double, double, double, int, int);
+public:
+	BackgroundLayer(SDL_Renderer*, TextRenderer&);
+	~BackgroundLayer();
+	BackgroundLayer(const BackgroundLayer&) = delete;
+	BackgroundLayer& operator=(const BackgroundLayer&) = delete;
+
+	// replaces the whole current target, falling back to drawing directly without render targets
+	void draw(double minX, double maxX, double minY, double maxY, int width, int height);
+	// forces a redraw, e.g. after the renderer lost its target textures
+	void invalidate();
+	void release();
+};
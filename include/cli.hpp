@@ -3,6 +3,7 @@
 #include <cxxopts.hpp>
 #include <string>
 #include <optional>
+#include <vector>
 
 class CliHandler {
 private:
@@ -13,6 +14,15 @@ public:
 	~CliHandler() = default;
 	std::string fontFilePath();
 	std::optional<std::string> loadPath();
+	std::optional<std::string> tracePath();
+	bool headless();
+	std::vector<std::string> outPaths();
+	std::vector<std::string> views();
+	std::optional<std::string> batchPath();
+	float lineWidth();
+	int threads();
+	int sampleCacheMegabytes();
+	double timeLimit();
 	int width();
 	int height();
 };
\ No newline at end of file
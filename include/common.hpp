@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -8,6 +9,8 @@ typedef std::vector<std::string>& strvecr;
 typedef long double ld;
 typedef std::function<ld(ld)> Function;
 typedef std::function<ld(ld, ld)> Operator;
+// index of a user function, assigned in definition order
+typedef uint32_t FunctionId;
 
 void sortStrVecByFirstChar(strvecr);
 
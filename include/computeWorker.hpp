@@ -0,0 +1,110 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "frameScheduler.hpp"
+#include "functionFactory.hpp"
+#include "sampler.hpp"
+#include "spscQueue.hpp"
+#include "tasks.hpp"
+
+// Samples curves off the UI thread so input and drawing never wait for evaluation. The UI
+// thread submits a viewport with the compiled visible functions, the worker refines them in
+// rounds shared out by a FrameScheduler and publishes screen polylines after every round. Rounds
+// run one at a time as interactive tasks on the shared pool, each scheduling the next while
+// work is left. Results go through three slots swapped atomically: the worker fills one, the
+// reader holds another and the third is the latest handed over, so neither side ever waits for
+// the other. A newer submission cancels the current one between refinement slices.
+class ComputeWorker {
+public:
+	struct View {
+		double minX = 0.0, maxX = 0.0, minY = 0.0, maxY = 0.0;
+		int screenWidth = 0, screenHeight = 0;
+		bool operator==(const View&) const = default;
+	};
+
+	struct Snapshot {
+		FunctionId id;
+		std::shared_ptr<const CompiledFunction> fn;
+		uint64_t revision;
+	};
+
+	// points are on the screen of the result's view, ys keep the sampled values to split runs
+	struct Polyline {
+		FunctionId id;
+		std::vector<SDL_FPoint> points;
+		std::vector<double> ys;
+	};
+
+	struct Result {
+		uint64_t generation = 0;
+		View view;
+		std::vector<Polyline> curves;
+		size_t cacheTiles = 0;
+		size_t cacheBytes = 0;
+	};
+private:
+	struct Request {
+		uint64_t generation = 0;
+		View view;
+		std::vector<Snapshot> functions;
+		tasks::CancellationToken token;
+	};
+
+	struct Progress {
+		std::shared_ptr<const CompiledFunction> fn; // the sampler points into it
+		uint64_t revision = 0;
+		sampler::AdaptiveSampler sampler;
+	};
+
+	static constexpr int FRESH = 4;
+
+	SpscQueue<Request, 4> requests;
+	std::atomic<bool> scheduled = false;
+	std::atomic<bool> stopping = false;
+	tasks::Group rounds;
+
+	std::array<Result, 3> results;
+	std::atomic<int> handoff = 1;
+	int writing = 0; // worker side
+	int reading = 2; // reader side
+
+	// UI side
+	uint64_t generation = 0;
+	tasks::CancellationToken submitted;
+
+	// worker side, only ever touched by the round in progress
+	std::function<void()> published;
+	Request current;
+	Request next;
+	bool pending = false;
+	sampler::SampleCache cache;
+	FrameScheduler scheduler;
+	std::vector<Progress> progress; // indexed by FunctionId
+
+	void schedule();
+	void round();
+	void begin(const Request&);
+	// false when the request was cancelled before the round finished
+	bool refine(const Request&);
+	void publish(const Request&);
+public:
+	// published is called on a pool thread after every new result
+	ComputeWorker(size_t sampleCacheBytes, std::function<void()> published);
+	~ComputeWorker();
+	ComputeWorker(const ComputeWorker&) = delete;
+	ComputeWorker& operator=(const ComputeWorker&) = delete;
+
+	// UI thread only. Returns false when the queue is full, the caller should retry later.
+	bool submit(const View&, std::vector<Snapshot>&&);
+	// UI thread only. The latest published result, valid until the next call.
+	const Result& acquire();
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.hpp"
+
+// Shares the per-frame plotting budget between the functions on screen. A function's cost per
+// evaluation is priced from its compiled size until it has been timed, then from a moving average
+// of its timings. Cheaper functions go first and each one is given an equal share of what is left
+// as a number of evaluations, so an expensive function only gets what the others did not use.
+// Whatever does not fit stays pending in the caller's sampler for the next frame.
+class FrameScheduler {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	struct Slice {
+		size_t evaluations;
+		clock::time_point deadline; // guards against a cost that was underestimated
+	};
+private:
+	struct Estimate {
+		uint64_t revision = 0;
+		size_t compiledSize = 0;
+		double nsPerEvaluation = 0.0; // zero until measured
+	};
+
+	static constexpr size_t MIN_EVALUATIONS = 16;
+
+	std::vector<Estimate> estimates; // indexed by FunctionId
+	double nsPerNode = 20.0; // learned from every function, prices the unmeasured ones
+	clock::time_point frameDeadline;
+public:
+	// forgets the timings of a function whose revision changed
+	void update(FunctionId id, uint64_t revision, size_t compiledSize);
+	// estimated nanoseconds per evaluation
+	double cost(FunctionId id) const;
+
+	void beginFrame(clock::duration budget);
+	// sorts the functions still to be refined this frame cheapest first
+	void order(std::vector<FunctionId>& pending) const;
+	// share of the remaining frame budget for id when functionsLeft still have to run, id included
+	Slice slice(FunctionId id, size_t functionsLeft) const;
+	void record(FunctionId id, size_t evaluations, clock::duration elapsed);
+};
@@ -1,32 +1,104 @@
 #pragma once
 
+#include <atomic>
 #include <string>
-#include <stack>
-#include <queue>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
 
 #include "common.hpp"
 
 typedef std::map<std::string, Function> functionMapping;
 
+// sin, cos, log, exp, logtwo, tan and pi
+functionMapping standardFunctions();
+
+// Never changed once compiled, so it can be shared between threads freely. It shares the
+// versions of the functions it calls, redefining one later does not affect it.
+struct CompiledFunction {
+	Function fn;
+	std::string expression;
+	std::set<FunctionId> references; // user functions it calls
+	size_t size = 0; // operations one evaluation runs, counting the bodies of called user functions
+};
+
+// indexed by FunctionId
+typedef std::vector<std::shared_ptr<const CompiledFunction>> compiledTable;
+
+// What an expression may call. Names are only resolved here, a call holds its callee directly,
+// and only user functions with an ID below id can be called.
+struct CompileContext {
+	const functionMapping& builtIns;
+	const std::unordered_map<std::string, FunctionId>& ids;
+	const compiledTable& userFunctions;
+	FunctionId id;
+};
+
+// Scratch buffers reused by successive compilations, one arena per thread.
+struct CompileArena {
+	std::vector<std::string> tokens;
+	std::vector<std::string> parsed;
+	std::vector<std::string> operators;
+	std::vector<Function> operands;
+};
+
+// Touches nothing but its arguments, so any number of threads can compile at once as long as
+// each passes its own arena or none. Throws std::invalid_argument or std::runtime_error.
+std::shared_ptr<const CompiledFunction> compile(const std::string& expression, const CompileContext&, CompileArena* = nullptr);
+
+// Splits a "name = expression" line, the name may also be written as name(x). A line without
+// '=' is the older format of a one letter name followed directly by the expression.
+std::pair<std::string, std::string> splitDefinition(const std::string& line);
+
+// One published version of the user functions. Never modified once published, so a reader
+// holding the pointer sees a consistent set however the factory changes meanwhile. IDs are
+// handed out in definition order and never reused, everything is indexed by them.
+struct FunctionSnapshot {
+	compiledTable functions; // null for a name whose first definition failed
+	std::vector<std::string> names;
+	std::vector<uint64_t> ownRevisions;
+	// changes whenever the function or anything it calls is redefined
+	std::vector<uint64_t> revisions;
+	std::unordered_map<std::string, FunctionId> ids;
+
+	size_t size() const { return functions.size(); }
+	std::optional<FunctionId> find(const std::string& name) const;
+	uint64_t revision(FunctionId) const;
+	// number of operations one evaluation runs, counting the bodies of called user functions
+	size_t compiledSize(FunctionId) const;
+};
+
+// Edits compile against the current snapshot and publish a new one, readers take the latest with
+// a single atomic load and never wait for a compilation. A version is freed with its last reader.
+// std::atomic<std::shared_ptr> is not lock-free in libstdc++ or MSVC: loads and stores take a
+// short internal lock around the pointer copy, so a reader can briefly wait for another reader
+// or a publication, though never for longer than a reference count update.
 class FunctionFactory {
 private:
-	void tokenize(std::string&);
-	void parse();
-	Function buildFunction(char);
-	functionMapping functions;
 	functionMapping builtInFunctions;
-	std::queue<std::string> parsed;
-	std::vector<std::string> tokens;
-	std::map<char, std::string> savedStrs;
+	std::atomic<std::shared_ptr<const FunctionSnapshot>> current = std::make_shared<const FunctionSnapshot>();
+	std::mutex writer; // guards everything below, edits are applied one at a time
+	uint64_t revisionCounter = 0;
+	CompileArena arena;
+	void checkName(const std::string&) const;
 	void loadFunctions(strvecr);
 public:
 	FunctionFactory() = default;
 	FunctionFactory(functionMapping&);
 	FunctionFactory(functionMapping&, strvecr);
 	~FunctionFactory() = default;
-	const functionMapping& getFunctions();
-	void parseFunction(std::string expression, char identifier);
-	std::vector<std::string> exportFunctions();
+	std::shared_ptr<const FunctionSnapshot> snapshot() const;
+	// defines or redefines name, a new name gets the next ID
+	FunctionId parseFunction(std::string expression, const std::string& name);
+	// "name(x) = expression" lines in ID order
+	std::vector<std::string> exportFunctions() const;
+	// Lines are compiled by dependency level, each level in parallel, and published together.
+	// Failed lines keep their previous definition and are all named in one std::invalid_argument.
 	void importFunctions(strvecr);
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "common.hpp"
+#include "tasks.hpp"
 
 #include <vector>
 
-std::vector<ld> getZeroes(Function fn);
+// Newton's method from evenly spread starting points. Stops between blocks of starting points
+// once the cancellation applies, roots then holds what was found so far.
+tasks::Status getZeroes(Function fn, std::vector<ld>& roots, const tasks::Cancellation& = {});
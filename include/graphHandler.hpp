@@ -3,22 +3,111 @@
 #include <SDL2/SDL.h>
 #include <SDL_ttf.h>
 #include "common.hpp"
+#include "textRenderer.hpp"
+#include "sampler.hpp"
+
+#include <array>
+#include <string_view>
+#include <vector>
 
 
 namespace graph {
 
-    void plotFunction(SDL_Renderer*, Function&,
+    // colors of the first six functions
+    inline constexpr std::array<SDL_Color, 6> FUNCTION_COLORS = {
+        SDL_Color{255, 0, 0, 255},
+        SDL_Color{0, 255, 0, 255},
+        SDL_Color{0, 128, 255, 255},
+        SDL_Color{255, 255, 0, 255},
+        SDL_Color{255, 0, 255, 255},
+        SDL_Color{0, 255, 255, 255}
+    };
+
+    // FUNCTION_COLORS first, then hues a golden angle apart so neighbouring IDs stay distinct
+    SDL_Color functionColor(FunctionId);
+
+    // lineWidth <= 0 draws aliased 1 pixel lines
+    void plotFunction(SDL_Renderer*, const Function&,
+        double, double, double, double,
+        int, int, SDL_Color, float lineWidth, sampler::SampleCache* = nullptr, int slot = 0);
+
+    // draws already sampled points, split wherever a sample is off screen or not finite
+    void drawCurve(SDL_Renderer*, const std::vector<double>&, const std::vector<double>&,
+        double, double, double, double,
+        int, int, SDL_Color, float lineWidth);
+
+    // same for points already mapped to the screen, ys deciding which are in range
+    void drawCurve(SDL_Renderer*, const SDL_FPoint*, const double*, size_t,
+        double, double, SDL_Color, float lineWidth);
+
+    // never more evaluations per full sampling than the old uniform screenWidth * 2 grid
+    inline size_t sampleBudget(int screenWidth) {
+        return static_cast<size_t>(screenWidth) * 2 + 1;
+    }
+
+    // Draws the min/max span of 8 evenly spaced samples per pixel column, a fixed cost at any
+    // zoom. Features narrower than an eighth of a column can still be missed.
+    void plotEnvelope(SDL_Renderer*, const Function&,
         double, double, double, double,
         int, int, SDL_Color);
 
+    void toScreen(const double*, const double*, size_t,
+        double, double, double, double,
+        int, int, SDL_FPoint*);
+
+    // maps points from the screen of the first view to the screen of the second
+    void reproject(const SDL_FPoint*, size_t,
+        double, double, double, double, int, int,
+        double, double, double, double, int, int, SDL_FPoint*);
+
+    // draws each run of in-range samples with a single SDL_RenderDrawLinesF call
+    void drawPolylines(SDL_Renderer*, const SDL_FPoint*, const double*, size_t,
+        double, double);
+
+    // Each run of in-range samples becomes a triangle strip of four vertices per point: a core
+    // of the full color lineWidth - 1 pixels wide and a one pixel feather on either side fading
+    // to transparent. Widths below one pixel lower the alpha instead. Appends to the vectors.
+    void buildStroke(const SDL_FPoint*, const double*, size_t, double, double,
+        float lineWidth, SDL_Color, std::vector<SDL_Vertex>&, std::vector<int>&);
+
+    // draws the strokes of all runs with a single SDL_RenderGeometry call
+    void drawStroke(SDL_Renderer*, const SDL_FPoint*, const double*, size_t,
+        double, double, float lineWidth, SDL_Color);
+
     int mapY(double, double, double, int);
 
     int mapX(double, double, double, int);
 
     double calculateStepSize(double);
 
+    const int LABEL_SIZE = 10;
+
+    struct Segment {
+        int x0, y0, x1, y1;
+        SDL_Color color;
+    };
+
+    // x axis labels are centered horizontally on x with their top at y,
+    // y axis labels end at x and are centered vertically on y
+    struct Label {
+        enum class Anchor { Top, Right };
+        char text[32];
+        size_t length;
+        int x, y;
+        Anchor anchor;
+        std::string_view view() const { return { text, length }; }
+    };
+
+    // Grid lines, axes and tick labels as plain primitives so the SDL renderer and the software
+    // rasterizer draw the same picture. Both append to the given vectors.
+    void gridLayout(double, double, double, double,
+        int, int, std::vector<Segment>&);
+
+    void axesLayout(double, double, double, double,
+        int, int, std::vector<Segment>&, std::vector<Label>&);
+
     void drawAxes(SDL_Renderer*, double, double, double, double,
-        int, int, const char*);
+        int, int, TextRenderer&);
 
     void drawGrid(SDL_Renderer*, double, double, double, double,
         int, int);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tasks.hpp"
+
+namespace headless {
+
+    struct Job {
+        std::string outPath;
+        double minX = -10.0;
+        double maxX = 10.0;
+        double minY = -5.0;
+        double maxY = 5.0;
+        std::optional<std::string> functionsPath;
+    };
+
+    // parses "x0,x1,y0,y1", throws std::invalid_argument
+    void parseView(const std::string&, Job&);
+
+    // Pairs each --out with the --view at the same position. A single view applies to every
+    // output and no view keeps the interactive default. Throws std::invalid_argument.
+    std::vector<Job> jobsFromArguments(const std::vector<std::string>& outPaths,
+        const std::vector<std::string>& views, const std::optional<std::string>& functionsPath);
+
+    // One job per non-empty line: "<out> <x0,x1,y0,y1> [functions file]", '#' starts a comment.
+    // Jobs without a functions file use functionsPath. Throws std::runtime_error.
+    std::vector<Job> loadJobs(const std::string& path, const std::optional<std::string>& functionsPath);
+
+    // Rasterizes every job on the CPU in vertical strips spread over the task pool, no window or
+    // video subsystem needed. Functions files are parsed once and reused by every job
+    // naming them. Failed jobs are reported on stderr. Once the cancellation applies the image
+    // in progress is dropped and the remaining jobs are skipped, the images already written stay.
+    // Returns the process exit code.
+    int run(const std::vector<Job>&, int width, int height, const std::string& fontPath, float lineWidth,
+        const tasks::Cancellation& = {});
+
+}
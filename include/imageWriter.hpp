@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace image {
+
+    // Pixels are 8-bit RGBA rows, pitch bytes apart. Alpha is dropped on write.
+    // Failures throw std::runtime_error.
+    void savePng(const std::string& path, const uint8_t* pixels, int width, int height, int pitch);
+    void savePpm(const std::string& path, const uint8_t* pixels, int width, int height, int pitch);
+
+    // picks the format from the extension, PNG unless it is .ppm
+    void save(const std::string& path, const uint8_t* pixels, int width, int height, int pitch);
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tracing.hpp"
+
+namespace profiler {
+
+    typedef std::chrono::steady_clock clock;
+
+    constexpr size_t WINDOW = 120; // ~2s of frames at 60 FPS
+
+    // Timings are accumulated per frame and committed into a rolling window by endFrame().
+    // Stages are meant to be used from the render thread only.
+    class Stage {
+    private:
+        const char* name;
+        std::array<double, WINDOW> samples{};
+        size_t cursor = 0;
+        size_t count = 0;
+        double pending = 0.0;
+    public:
+        explicit Stage(const char*);
+        void add(double ms);
+        void commit();
+        const char* label() const;
+        double average() const;
+        double p99() const;
+    };
+
+    class ScopedTimer {
+    private:
+        Stage& stage;
+        clock::time_point start;
+        tracing::Span span;
+    public:
+        explicit ScopedTimer(Stage&);
+        explicit ScopedTimer(const char*);
+        ~ScopedTimer();
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    };
+
+    // lookup is linear, cache the reference in a static at hot call sites
+    Stage& stage(const char*);
+
+    void countEvaluations(size_t);
+    void endFrame();
+
+    double fps();
+    double evaluationsPerFrame();
+    std::vector<std::string> report();
+
+}
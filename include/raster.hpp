@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL_ttf.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "tasks.hpp"
+
+namespace raster {
+
+    // Glyph coverage of one font size rendered once on the CPU, laid out like TextRenderer.
+    class Font {
+    private:
+        static constexpr char FIRST_GLYPH = ' ';
+        static constexpr char LAST_GLYPH = '~';
+
+        struct Glyph {
+            SDL_Surface* surface = nullptr;
+            int advance = 0;
+        };
+
+        TTF_Font* font = nullptr;
+        std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs{};
+        int height = 0;
+    public:
+        Font(const std::string& path, int size);
+        ~Font();
+        Font(const Font&) = delete;
+        Font& operator=(const Font&) = delete;
+
+        bool ready() const;
+        int lineHeight() const;
+        int measure(std::string_view) const;
+        // ARGB8888 coverage in the alpha channel, null for blank glyphs
+        const SDL_Surface* surface(char) const;
+        int advance(char) const;
+    };
+
+    // Vertical slice [left, right) of an RGBA32 framebuffer. Primitives are always rasterized
+    // whole and only the writes are clipped, so anything crossing a strip edge produces the
+    // same pixels as on the full image.
+    class Strip {
+    private:
+        uint8_t* pixels;
+        int pitch;
+        int left;
+        int right;
+        int height;
+        std::vector<uint8_t> coverage; // strip sized, only the covered rectangle is non-zero
+        int coveredLeft, coveredRight, coveredTop, coveredBottom;
+
+        void put(int x, int y, SDL_Color);
+        void blend(int x, int y, SDL_Color, int alpha);
+    public:
+        Strip(uint8_t* pixels, int pitch, int left, int right, int height);
+
+        int begin() const;
+        int end() const;
+        void clear(SDL_Color);
+        void drawLine(int x0, int y0, int x1, int y1, SDL_Color);
+        void drawText(const Font&, std::string_view, int x, int y, SDL_Color);
+
+        // Anti-aliased strokes: coverSegment keeps the highest coverage of every pixel so joints
+        // are not blended twice, fillCoverage then blends it in one color and resets it. Coverage
+        // is computed from the distance of each pixel center to the segment, like drawStroke's
+        // one pixel feather.
+        void coverSegment(float x0, float y0, float x1, float y1, float lineWidth);
+        void fillCoverage(SDL_Color);
+    };
+
+    struct Curve {
+        const Function* fn;
+        SDL_Color color;
+    };
+
+    // Draws the grid, axes, labels and curves into an RGBA32 framebuffer split into vertical
+    // strips rendered as background tasks (0 strips gives one per pool worker). Each strip
+    // evaluates only its own x-range on a grid anchored to the whole image, so the output does
+    // not depend on the strip count.
+    // font may be null to skip labels, lineWidth <= 0 draws aliased 1 pixel lines.
+    // Once the cancellation applies the remaining strips and curves are left out and the image
+    // is incomplete, which the returned status tells.
+    tasks::Status render(uint8_t* pixels, int pitch, int width, int height,
+        double minX, double maxX, double minY, double maxY,
+        const std::vector<Curve>&, const Font*, int strips, float lineWidth,
+        const tasks::Cancellation& = {}, size_t* evaluations = nullptr);
+
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "common.hpp"
+#include "tasks.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace sampler {
+
+    // Function samples shared by every zoom level. A sample at x = key * 2^exponent is stored
+    // under its canonical form (odd key, or zero), so the grids of neighbouring power-of-two
+    // spacings find each other's samples: zooming out is served entirely from the finer level
+    // and zooming in only evaluates the new midpoints. Samples are grouped into tiles per
+    // function slot and evicted least recently used first once the byte cap is reached.
+    class SampleCache {
+    private:
+        static constexpr int TILE_BITS = 6;
+
+        struct TileKey {
+            int slot;
+            int exponent;
+            int64_t index;
+            bool operator==(const TileKey&) const = default;
+        };
+
+        struct TileKeyHash {
+            size_t operator()(const TileKey&) const;
+        };
+
+        struct Tile {
+            std::array<double, 1 << TILE_BITS> values;
+            uint64_t present = 0;
+            std::list<TileKey>::iterator use;
+        };
+
+        size_t capacity;
+        std::unordered_map<TileKey, Tile, TileKeyHash> tiles;
+        std::list<TileKey> lru; // most recently used first
+        std::map<int, uint64_t> revisions;
+
+        static TileKey locate(int slot, int exponent, int64_t key, int& offset);
+        void touch(Tile&);
+        void evict();
+    public:
+        static constexpr int FINE_BITS = 16;
+        static constexpr size_t TILE_BYTES = sizeof(Tile) + 2 * sizeof(TileKey) + 32;
+
+        explicit SampleCache(size_t capacityBytes = 64 << 20);
+
+        // drops the slot's tiles when its revision differs from the cached one
+        void setRevision(int slot, uint64_t revision);
+        bool lookup(int slot, int exponent, int64_t key, double& y);
+        void store(int slot, int exponent, int64_t key, double y);
+        size_t bytes() const;
+        size_t tileCount() const;
+    };
+
+    // Adaptive sampling that can be spread over several frames. start() evaluates a coarse grid
+    // so there is always something to draw, refine() then splits the intervals where the curve
+    // bends by more than half a pixel, is steep, or leaves the screen or its domain until it is
+    // cancelled or past its deadline, nothing is flagged, or the budget or the call's evaluation
+    // limit is spent. Cancellation is checked every 16 splits and the samples so far stay
+    // drawable. Discontinuities are marked last. Starting again drops any refinement still
+    // pending. The function must outlive the sampler until the next start().
+    class AdaptiveSampler {
+    private:
+        enum class Stage { Refining, Breaks, Done };
+
+        const Function* fn = nullptr;
+        SampleCache* cache = nullptr;
+        int slot = 0;
+        double minX = 0.0, maxX = 0.0, minY = 0.0, maxY = 0.0;
+        int screenWidth = 0, screenHeight = 0;
+        size_t budget = 0;
+        double pxPerX = 0.0, pxPerY = 0.0;
+        int fineExponent = 0;
+        double origin = 0.0; // x of key 0, moved to the view when keys from x = 0 would overflow
+        Stage stage = Stage::Done;
+        size_t points = 0;
+        size_t used = 0;
+        size_t allowance = 0;
+
+        std::vector<int64_t> keys;
+        std::vector<double> xs;
+        std::vector<double> ys;
+        std::vector<double> scores;
+        std::vector<size_t> flagged;
+        std::vector<size_t> resume; // flagged intervals an interrupted pass did not split
+        std::vector<int64_t> nextKeys;
+        std::vector<double> nextXs;
+        std::vector<double> nextYs;
+
+        double toX(int64_t key) const;
+        double sample(int64_t key);
+        // picks the intervals of the next pass, false when none need splitting
+        bool flag(size_t refineBudget);
+        bool refinePass(const tasks::Cancellation&, size_t refineBudget);
+        void markBreaks();
+    public:
+        // both return the number of evaluations, which excludes samples served from the cache
+        size_t start(const Function&,
+            double minX, double maxX, double minY, double maxY,
+            int screenWidth, int screenHeight, size_t budget,
+            SampleCache* cache = nullptr, int slot = 0);
+        size_t refine(const tasks::Cancellation&, size_t maxEvaluations = SIZE_MAX);
+
+        bool done() const;
+        // true when started on exactly this view
+        bool matches(double minX, double maxX, double minY, double maxY, int screenWidth, int screenHeight) const;
+        const std::vector<double>& sampleXs() const;
+        const std::vector<double>& sampleYs() const;
+    };
+
+    // evaluates fn, mapping exceptions to NaN so callers can treat them as gaps
+    double evaluate(const Function&, double);
+
+    // Starts from a coarse grid with power-of-two spacing aligned to x = 0 and runs
+    // AdaptiveSampler to completion. Segments jumping against their neighbours' slope are
+    // bisected and confirmed poles and jumps are marked by a NaN sample between their bracket,
+    // so curves are split there instead of joined. Returns the number of evaluations, which
+    // excludes samples served from the cache.
+    size_t sampleAdaptive(const Function&,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, size_t budget,
+        std::vector<double>& xs, std::vector<double>& ys,
+        SampleCache* cache = nullptr, int slot = 0);
+
+    // Uniform grid of samplesPerColumn points per pixel column anchored at minX, keeping grid
+    // indices first to last. Intervals that are steep or cross the screen or domain edge are
+    // bisected, and discontinuities marked with a NaN like sampleAdaptive, using only the interval
+    // and its grid neighbours. Any index range therefore reproduces exactly the samples of the
+    // full range and vertical strips of the screen can be sampled independently.
+    // Returns the number of evaluations.
+    size_t sampleColumns(const Function&,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, int samplesPerColumn,
+        int64_t first, int64_t last,
+        std::vector<double>& xs, std::vector<double>& ys);
+
+    // Per pixel column minimum and maximum of fn from samplesPerColumn + 1 evenly spaced
+    // samples, column edges shared with the neighbours so spans stay connected. Columns
+    // without a finite sample get NaN. Returns the number of evaluations.
+    size_t sampleEnvelope(const Function&, double minX, double maxX,
+        int columns, int samplesPerColumn,
+        std::vector<double>& lows, std::vector<double>& highs);
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread. Items are moved into
+// preallocated slots, so slots keep their storage when T reuses it on assignment.
+template <typename T, size_t Capacity>
+class SpscQueue {
+private:
+	std::array<T, Capacity> slots;
+	alignas(64) std::atomic<size_t> head = 0; // next slot to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail = 0; // next slot to push, written by the producer
+public:
+	// producer only, false when full
+	bool push(T&& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		slots[t % Capacity] = std::move(item);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only
+	bool empty() const {
+		return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+	}
+
+	// consumer only, false when empty
+	bool pop(T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		item = std::move(slots[h % Capacity]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
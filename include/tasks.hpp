@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace tasks {
+
+    // interactive work is always taken before background work
+    enum class Priority { Interactive, Background };
+
+    // Copies share one flag. Cancelling never interrupts a task, it is up to the work to check.
+    class CancellationToken {
+    private:
+        std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+    public:
+        void cancel() const { flag->store(true, std::memory_order_release); }
+        bool cancelled() const { return flag->load(std::memory_order_acquire); }
+    };
+
+    // how a long operation ended, anything but Complete means its results are partial
+    enum class Status { Complete, Cancelled, TimedOut };
+
+    const char* describe(Status);
+
+    // A token and a deadline, both optional, checked by long operations between blocks of work.
+    struct Cancellation {
+        CancellationToken token;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+        Status status() const;
+    };
+
+    // tasks submitted with a group and not finished yet
+    struct Group {
+        std::atomic<size_t> pending = 0;
+    };
+
+    // Starts the shared pool with the given number of workers, 0 uses every core. Without an
+    // explicit start the first submission starts it with every core. Later calls do nothing.
+    void start(int threads);
+    size_t workerCount();
+
+    // Each worker owns a deque per priority, runs its own newest task first and otherwise steals
+    // the oldest from the others. Tasks must not throw.
+    void submit(std::function<void()>, Priority, Group* = nullptr);
+
+    // returns once every task of the group finished, running the group's queued tasks meanwhile
+    void wait(Group&);
+
+    // Runs body(i) for every i below count on the pool and waits for them. Items that have not
+    // started once the cancellation applies are skipped. The first exception thrown by body is
+    // rethrown here. Returns why items were skipped, Complete when none were.
+    Status parallelFor(size_t count, Priority, const Cancellation&, const std::function<void(size_t)>& body);
+
+}
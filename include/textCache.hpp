@@ -0,0 +1,73 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "textRenderer.hpp"
+
+// Keeps whole rendered strings as textures, keyed on (text, size, color), so unchanged overlay
+// text costs one copy per frame. Least recently used entries are evicted past the byte cap.
+class TextCache {
+private:
+	struct KeyView {
+		std::string_view text;
+		int size;
+		Uint32 color;
+	};
+
+	struct Key {
+		std::string text;
+		int size;
+		Uint32 color;
+		operator KeyView() const { return { text, size, color }; }
+	};
+
+	struct KeyHash {
+		using is_transparent = void;
+		size_t operator()(const KeyView&) const;
+		size_t operator()(const Key& key) const { return (*this)(KeyView(key)); }
+	};
+
+	struct KeyEqual {
+		using is_transparent = void;
+		bool operator()(const KeyView& a, const KeyView& b) const {
+			return a.size == b.size && a.color == b.color && a.text == b.text;
+		}
+		bool operator()(const Key& a, const KeyView& b) const { return (*this)(KeyView(a), b); }
+		bool operator()(const KeyView& a, const Key& b) const { return (*this)(a, KeyView(b)); }
+		bool operator()(const Key& a, const Key& b) const { return (*this)(KeyView(a), KeyView(b)); }
+	};
+
+	struct Entry {
+		Key key;
+		SDL_Texture* texture;
+		int w;
+		int h;
+		size_t bytes;
+	};
+
+	SDL_Renderer* renderer;
+	TextRenderer& text;
+	size_t capacity;
+	size_t used = 0;
+	std::list<Entry> entries; // most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash, KeyEqual> index;
+
+	const Entry* render(const KeyView&, SDL_Color);
+	void evict();
+public:
+	TextCache(SDL_Renderer*, TextRenderer&, size_t capacityBytes = 8 << 20);
+	~TextCache();
+	TextCache(const TextCache&) = delete;
+	TextCache& operator=(const TextCache&) = delete;
+
+	// returns the drawn width
+	int draw(std::string_view, int x, int y, int size, SDL_Color);
+	size_t bytes() const;
+	size_t size() const;
+	void release();
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL_ttf.h>
+#include <array>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Draws text from one glyph atlas texture per font size. Each size is opened and rasterized
+// once; draw() only appends quads and flush() submits them in a single SDL_RenderGeometry call.
+class TextRenderer {
+private:
+	static constexpr char FIRST_GLYPH = ' ';
+	static constexpr char LAST_GLYPH = '~';
+
+	struct Glyph {
+		SDL_Rect src;
+		int advance;
+	};
+
+	struct Atlas {
+		TTF_Font* font = nullptr;
+		SDL_Texture* texture = nullptr;
+		int width = 0;
+		int height = 0;
+		int lineHeight = 0;
+		std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs{};
+	};
+
+	SDL_Renderer* renderer;
+	std::string fontPath;
+	std::map<int, Atlas> atlases;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+	SDL_Texture* batchTexture = nullptr;
+
+	Atlas* atlas(int size);
+	const Glyph* glyph(const Atlas&, char) const;
+public:
+	TextRenderer(SDL_Renderer*, std::string fontPath);
+	~TextRenderer();
+	TextRenderer(const TextRenderer&) = delete;
+	TextRenderer& operator=(const TextRenderer&) = delete;
+
+	bool ready(int size);
+	int lineHeight(int size);
+	int measure(std::string_view, int size);
+	void draw(std::string_view, int x, int y, int size, SDL_Color);
+	void flush();
+	// frees fonts and textures, must run before the renderer is destroyed and TTF_Quit
+	void release();
+};
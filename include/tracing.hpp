@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace tracing {
+
+    namespace detail {
+        inline std::atomic<bool> active = false;
+        uint64_t now();
+        void record(const char*, uint64_t, uint64_t);
+    }
+
+    inline bool enabled() {
+        return detail::active.load(std::memory_order_relaxed);
+    }
+
+    void start(const std::string& path);
+    bool flush();
+    void stop();
+
+    // Records a complete ("X") event into the calling thread's ring buffer.
+    // When tracing is off this costs a single relaxed load.
+    class Span {
+    private:
+        const char* name;
+        uint64_t begin = 0;
+        bool recording;
+    public:
+        explicit Span(const char* name) : name(name), recording(enabled()) {
+            if (recording) begin = detail::now();
+        }
+        ~Span() {
+            if (recording) detail::record(name, begin, detail::now());
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    };
+
+}
@@ -0,0 +1,144 @@
+#include "allocationCounter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <fmt/core.h>
+
+namespace {
+    // plain thread_local PODs, so the hook itself never allocates
+    thread_local allocations::Counts threadCounts;
+
+    // Every allocating thread also adds to a slot of its own, summed for the per-frame totals.
+    // Slots are never freed or reused, threads past the last one share it.
+    struct alignas(64) Slot {
+        std::atomic<size_t> allocations = 0;
+        std::atomic<size_t> bytes = 0;
+    };
+    constexpr size_t MAX_SLOTS = 64;
+    Slot slots[MAX_SLOTS];
+    std::atomic<size_t> slotsTaken = 0;
+    thread_local Slot* threadSlot = nullptr;
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<allocations::Operation>> operations;
+
+    allocations::Counts frameStart;
+    allocations::Counts previousFrame;
+    double averageAllocations = 0.0;
+    double averageBytes = 0.0;
+}
+
+#ifdef CALC_COUNT_ALLOCATIONS
+
+static void* countedAlloc(std::size_t size) {
+    threadCounts.allocations++;
+    threadCounts.bytes += size;
+    if (!threadSlot) threadSlot = &slots[std::min(slotsTaken.fetch_add(1, std::memory_order_relaxed), MAX_SLOTS - 1)];
+    threadSlot->allocations.fetch_add(1, std::memory_order_relaxed);
+    threadSlot->bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
+
+namespace allocations {
+
+    Counts current() {
+        return threadCounts;
+    }
+
+    Counts total() {
+        Counts sum;
+        size_t used = std::min(slotsTaken.load(std::memory_order_relaxed), MAX_SLOTS);
+        for (size_t i = 0; i < used; i++) {
+            sum.allocations += slots[i].allocations.load(std::memory_order_relaxed);
+            sum.bytes += slots[i].bytes.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    Operation::Operation(const char* name) : name(name) {}
+
+    void Operation::add(const Counts& counts) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        allocationCount.fetch_add(counts.allocations, std::memory_order_relaxed);
+        byteCount.fetch_add(counts.bytes, std::memory_order_relaxed);
+    }
+
+    const char* Operation::label() const {
+        return name;
+    }
+
+    double Operation::allocationsPerCall() const {
+        size_t n = calls.load(std::memory_order_relaxed);
+        return n ? static_cast<double>(allocationCount.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    double Operation::bytesPerCall() const {
+        size_t n = calls.load(std::memory_order_relaxed);
+        return n ? static_cast<double>(byteCount.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    Scope::Scope(Operation& operation) : operation(operation), start(current()) {}
+
+    Scope::Scope(const char* name) : Scope(allocations::operation(name)) {}
+
+    Scope::~Scope() {
+        Counts now = current();
+        operation.add({ now.allocations - start.allocations, now.bytes - start.bytes });
+    }
+
+    Operation& operation(const char* name) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& op : operations) {
+            if (std::strcmp(op->label(), name) == 0) return *op;
+        }
+        operations.push_back(std::make_unique<Operation>(name));
+        return *operations.back();
+    }
+
+    // counts every thread, the pool's sampling and root finding included
+    void endFrame() {
+        Counts now = total();
+        previousFrame = { now.allocations - frameStart.allocations, now.bytes - frameStart.bytes };
+        frameStart = now;
+
+        averageAllocations += (previousFrame.allocations - averageAllocations) * 0.05;
+        averageBytes += (previousFrame.bytes - averageBytes) * 0.05;
+    }
+
+    Counts lastFrame() {
+        return previousFrame;
+    }
+
+    std::vector<std::string> report() {
+        std::vector<std::string> lines;
+        if (!enabled()) {
+            lines.push_back("allocs: build with CALC_COUNT_ALLOCATIONS");
+            return lines;
+        }
+
+        lines.push_back(fmt::format("allocs/frame {} ({:.1f} avg)  bytes/frame {} ({:.0f} avg), all threads",
+            previousFrame.allocations, averageAllocations, previousFrame.bytes, averageBytes));
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& op : operations) {
+            lines.push_back(fmt::format("{:<8} {:8.1f} allocs {:10.0f} B per call",
+                op->label(), op->allocationsPerCall(), op->bytesPerCall()));
+        }
+        return lines;
+    }
+
+}
@@ -0,0 +1,71 @@
+#include "backgroundLayer.hpp"
+#include "graphHandler.hpp"
+#include "profiler.hpp"
+
+BackgroundLayer::BackgroundLayer(SDL_Renderer* renderer, TextRenderer& text) : renderer(renderer), text(text) {}
+
+BackgroundLayer::~BackgroundLayer() {
+	release();
+}
+
+void BackgroundLayer::release() {
+	if (texture) SDL_DestroyTexture(texture);
+	texture = nullptr;
+	valid = false;
+}
+
+void BackgroundLayer::invalidate() {
+	valid = false;
+}
+
+void BackgroundLayer::render(double minX, double maxX, double minY, double maxY, int width, int height) {
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	SDL_RenderClear(renderer);
+	{
+		profiler::ScopedTimer timer("grid");
+		graph::drawGrid(renderer, minX, maxX, minY, maxY, width, height);
+	}
+	{
+		profiler::ScopedTimer timer("axes");
+		graph::drawAxes(renderer, minX, maxX, minY, maxY, width, height, text);
+	}
+}
+
+void BackgroundLayer::draw(double minX, double maxX, double minY, double maxY, int width, int height) {
+	if (!SDL_RenderTargetSupported(renderer)) {
+		render(minX, maxX, minY, maxY, width, height);
+		return;
+	}
+
+	if (texture && (this->width != width || this->height != height)) {
+		release();
+	}
+	if (!texture) {
+		texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+		if (!texture) {
+			render(minX, maxX, minY, maxY, width, height);
+			return;
+		}
+		this->width = width;
+		this->height = height;
+	}
+
+	if (!valid || this->minX != minX || this->maxX != maxX || this->minY != minY || this->maxY != maxY) {
+		// labels still batched for the current target must not end up in the layer
+		text.flush();
+
+		SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+		SDL_SetRenderTarget(renderer, texture);
+		render(minX, maxX, minY, maxY, width, height);
+		SDL_SetRenderTarget(renderer, previousTarget);
+
+		this->minX = minX;
+		this->maxX = maxX;
+		this->minY = minY;
+		this->maxY = maxY;
+		valid = true;
+	}
+
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+	SDL_RenderCopy(renderer, texture, NULL, NULL);
+}
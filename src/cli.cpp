@@ -9,6 +9,15 @@ CliHandler::CliHandler(int argc, char** argv): options("calc", "graphical calcul
 		("font", "specify path to font file (ttf)", cxxopts::value<std::string>()->default_value("C:\\Windows\\Fonts\\arial.ttf"))
 		("w,width", "specify width, default 800", cxxopts::value<int>()->default_value("800"))
 		("h,height", "specify height, default 600", cxxopts::value<int>()->default_value("600"))
+		("trace", "record a Chrome trace-event JSON to path, written on exit or with t", cxxopts::value<std::string>())
+		("headless", "render images without a window, see --out, --view and --batch")
+		("out", "image to write in headless mode (.png or .ppm), repeatable", cxxopts::value<std::vector<std::string>>())
+		("view", "x0,x1,y0,y1 of the image with the same position as --out, repeatable", cxxopts::value<std::vector<std::string>>())
+		("batch", "headless job file, one \"<out> <x0,x1,y0,y1> [functions file]\" per line", cxxopts::value<std::string>())
+		("line-width", "curve width in pixels, anti-aliased; 0 draws aliased 1 pixel lines", cxxopts::value<float>()->default_value("1.5"))
+		("threads", "worker threads shared by plotting, root finding and export, 0 uses every core", cxxopts::value<int>()->default_value("0"))
+		("sample-cache", "memory for cached function samples in MB, default 64", cxxopts::value<int>()->default_value("64"))
+		("time-limit", "seconds a headless run may take, unfinished images are not written; 0 for no limit", cxxopts::value<double>()->default_value("0"))
 		;
 	options.parse_positional({ "file" });
 	parsed = options.parse(argc, argv);
@@ -27,6 +36,58 @@ std::optional<std::string> CliHandler::loadPath() {
 	}
 }
 
+std::optional<std::string> CliHandler::tracePath() {
+	if (parsed.count("trace")) {
+		return parsed["trace"].as<std::string>();
+	}
+	else {
+		return std::optional<std::string>();
+	}
+}
+
+bool CliHandler::headless() {
+	return parsed.count("headless") > 0;
+}
+
+std::vector<std::string> CliHandler::outPaths() {
+	if (parsed.count("out")) {
+		return parsed["out"].as<std::vector<std::string>>();
+	}
+	return {};
+}
+
+std::vector<std::string> CliHandler::views() {
+	if (parsed.count("view")) {
+		return parsed["view"].as<std::vector<std::string>>();
+	}
+	return {};
+}
+
+std::optional<std::string> CliHandler::batchPath() {
+	if (parsed.count("batch")) {
+		return parsed["batch"].as<std::string>();
+	}
+	else {
+		return std::optional<std::string>();
+	}
+}
+
+float CliHandler::lineWidth() {
+	return parsed["line-width"].as<float>();
+}
+
+int CliHandler::threads() {
+	return parsed["threads"].as<int>();
+}
+
+int CliHandler::sampleCacheMegabytes() {
+	return parsed["sample-cache"].as<int>();
+}
+
+double CliHandler::timeLimit() {
+	return parsed["time-limit"].as<double>();
+}
+
 int CliHandler::width() {
 	if (!parsed.count("width"))
 	{
@@ -0,0 +1,153 @@
+#include "computeWorker.hpp"
+#include "graphHandler.hpp"
+#include "profiler.hpp"
+#include "tracing.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace {
+	// refinement between two publications, about one frame
+	const auto ROUND_BUDGET = std::chrono::milliseconds(8);
+}
+
+ComputeWorker::ComputeWorker(size_t sampleCacheBytes, std::function<void()> published)
+	: published(std::move(published)), cache(sampleCacheBytes) {}
+
+ComputeWorker::~ComputeWorker() {
+	stopping.store(true, std::memory_order_release);
+	submitted.cancel();
+	tasks::wait(rounds);
+}
+
+bool ComputeWorker::submit(const View& view, std::vector<Snapshot>&& functions) {
+	Request request = { generation + 1, view, std::move(functions), tasks::CancellationToken() };
+	tasks::CancellationToken token = request.token;
+	if (!requests.push(std::move(request))) return false;
+
+	generation++;
+	submitted.cancel();
+	submitted = token;
+	if (!scheduled.exchange(true, std::memory_order_acq_rel)) schedule();
+	return true;
+}
+
+const ComputeWorker::Result& ComputeWorker::acquire() {
+	if (handoff.load(std::memory_order_acquire) & FRESH) {
+		reading = handoff.exchange(reading, std::memory_order_acq_rel) & ~FRESH;
+	}
+	return results[reading];
+}
+
+void ComputeWorker::schedule() {
+	tasks::submit([this]() { round(); }, tasks::Priority::Interactive, &rounds);
+}
+
+void ComputeWorker::round() {
+	if (!stopping.load(std::memory_order_acquire)) {
+		// only the newest request matters, older ones are stale already
+		bool received = false;
+		while (requests.pop(next)) received = true;
+		if (received) {
+			std::swap(current, next);
+			begin(current);
+			publish(current);
+			pending = true;
+		}
+		if (pending && refine(current)) publish(current);
+	}
+
+	if (pending && !stopping.load(std::memory_order_acquire)) {
+		schedule();
+		return;
+	}
+	// A request pushed after the queue was drained found the flag still set and left scheduling
+	// to us. A plain store here could be ordered after the emptiness check below and miss that
+	// push, the exchange is a read-modify-write on the same flag as submit's, so one of the two
+	// always sees the other: either submit reads false and schedules, or the check sees the push.
+	scheduled.exchange(false, std::memory_order_acq_rel);
+	if (!requests.empty() && !stopping.load(std::memory_order_acquire)
+		&& !scheduled.exchange(true, std::memory_order_acq_rel)) {
+		schedule();
+	}
+}
+
+void ComputeWorker::begin(const Request& request) {
+	tracing::Span span("computeBegin");
+	const View& v = request.view;
+	size_t evaluations = 0;
+
+	for (const Snapshot& s : request.functions) {
+		cache.setRevision(static_cast<int>(s.id), s.revision);
+		scheduler.update(s.id, s.revision, s.fn->size);
+
+		if (s.id >= progress.size()) progress.resize(s.id + 1);
+		Progress& p = progress[s.id];
+		if (p.revision == s.revision && p.sampler.matches(v.minX, v.maxX, v.minY, v.maxY, v.screenWidth, v.screenHeight)) {
+			continue;
+		}
+		p.fn = s.fn;
+		p.revision = s.revision;
+		auto started = FrameScheduler::clock::now();
+		size_t used = p.sampler.start(p.fn->fn, v.minX, v.maxX, v.minY, v.maxY, v.screenWidth, v.screenHeight,
+			graph::sampleBudget(v.screenWidth), &cache, static_cast<int>(s.id));
+		scheduler.record(s.id, used, FrameScheduler::clock::now() - started);
+		evaluations += used;
+	}
+	profiler::countEvaluations(evaluations);
+}
+
+bool ComputeWorker::refine(const Request& request) {
+	tracing::Span span("computeRound");
+	scheduler.beginFrame(ROUND_BUDGET);
+
+	std::vector<FunctionId> ids;
+	for (const Snapshot& s : request.functions) {
+		if (!progress[s.id].sampler.done()) ids.push_back(s.id);
+	}
+	scheduler.order(ids);
+
+	pending = false;
+	for (size_t i = 0; i < ids.size(); i++) {
+		Progress& p = progress[ids[i]];
+		FrameScheduler::Slice slice = scheduler.slice(ids[i], ids.size() - i);
+		auto started = FrameScheduler::clock::now();
+		size_t used = p.sampler.refine({ request.token, slice.deadline }, slice.evaluations);
+		scheduler.record(ids[i], used, FrameScheduler::clock::now() - started);
+		profiler::countEvaluations(used);
+		if (!p.sampler.done()) pending = true;
+
+		if (request.token.cancelled()) {
+			pending = false;
+			return false;
+		}
+	}
+	return true;
+}
+
+void ComputeWorker::publish(const Request& request) {
+	tracing::Span span("computePublish");
+	const View& v = request.view;
+	Result& r = results[writing];
+	r.generation = request.generation;
+	r.view = v;
+
+	r.curves.resize(request.functions.size());
+	for (size_t i = 0; i < request.functions.size(); i++) {
+		const Progress& p = progress[request.functions[i].id];
+		const std::vector<double>& xs = p.sampler.sampleXs();
+		const std::vector<double>& ys = p.sampler.sampleYs();
+
+		Polyline& line = r.curves[i];
+		line.id = request.functions[i].id;
+		line.points.resize(xs.size());
+		graph::toScreen(xs.data(), ys.data(), xs.size(), v.minX, v.maxX, v.minY, v.maxY,
+			v.screenWidth, v.screenHeight, line.points.data());
+		line.ys.assign(ys.begin(), ys.end());
+	}
+	r.cacheTiles = cache.tileCount();
+	r.cacheBytes = cache.bytes();
+
+	writing = handoff.exchange(writing | FRESH, std::memory_order_acq_rel) & ~FRESH;
+	if (published) published();
+}
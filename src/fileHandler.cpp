@@ -1,9 +1,11 @@
 #include "fileHandler.hpp"
+#include "tracing.hpp"
 
 #include <fstream>
 #include <iostream>
 
 std::vector<std::string> fileHandler::loadFunctions(std::string path) {
+    tracing::Span span("loadFunctions");
     std::vector<std::string> res;
 
     std::ifstream testFile(path);
@@ -36,6 +38,7 @@ std::vector<std::string> fileHandler::loadFunctions(std::string path) {
 }
 
 void fileHandler::saveFile(std::vector<std::string> functions, std::string path) {
+	tracing::Span span("saveFile");
 	std::ofstream fFile(path, std::ios::out);
 	for (std::string function : functions) {
 		fFile << function << "\n";
@@ -0,0 +1,68 @@
+#include "frameScheduler.hpp"
+
+#include <algorithm>
+
+namespace {
+	// timings of fewer evaluations are mostly clock noise
+	const size_t MIN_TIMED_EVALUATIONS = 8;
+	const double FUNCTION_SMOOTHING = 0.25;
+	const double NODE_SMOOTHING = 0.1;
+	// time allowed for a slice past the frame budget, so its minimum evaluations can run
+	const auto MIN_SLICE = std::chrono::microseconds(250);
+}
+
+void FrameScheduler::update(FunctionId id, uint64_t revision, size_t compiledSize) {
+	if (id >= estimates.size()) estimates.resize(id + 1);
+	Estimate& e = estimates[id];
+	if (e.revision == revision) return;
+	e.revision = revision;
+	e.compiledSize = std::max<size_t>(compiledSize, 1);
+	e.nsPerEvaluation = 0.0;
+}
+
+double FrameScheduler::cost(FunctionId id) const {
+	if (id >= estimates.size()) return nsPerNode;
+	const Estimate& e = estimates[id];
+	if (e.nsPerEvaluation > 0.0) return e.nsPerEvaluation;
+	return nsPerNode * std::max<size_t>(e.compiledSize, 1);
+}
+
+void FrameScheduler::beginFrame(clock::duration budget) {
+	frameDeadline = clock::now() + budget;
+}
+
+void FrameScheduler::order(std::vector<FunctionId>& pending) const {
+	std::stable_sort(pending.begin(), pending.end(), [&](FunctionId a, FunctionId b) { return cost(a) < cost(b); });
+}
+
+FrameScheduler::Slice FrameScheduler::slice(FunctionId id, size_t functionsLeft) const {
+	auto now = clock::now();
+	auto share = clock::duration::zero();
+	if (frameDeadline > now) {
+		share = (frameDeadline - now) / static_cast<long long>(std::max<size_t>(functionsLeft, 1));
+	}
+
+	// a small minimum keeps every curve moving even when the frame is already over budget
+	double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(share).count());
+	size_t evaluations = std::max(MIN_EVALUATIONS, static_cast<size_t>(ns / cost(id)));
+	clock::duration allowed = std::max<clock::duration>(2 * share, MIN_SLICE);
+	return { evaluations, now + allowed };
+}
+
+void FrameScheduler::record(FunctionId id, size_t evaluations, clock::duration elapsed) {
+	if (evaluations < MIN_TIMED_EVALUATIONS) return;
+	if (id >= estimates.size()) estimates.resize(id + 1);
+
+	double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	double measured = ns / evaluations;
+
+	Estimate& e = estimates[id];
+	if (e.nsPerEvaluation > 0.0) {
+		e.nsPerEvaluation += (measured - e.nsPerEvaluation) * FUNCTION_SMOOTHING;
+	}
+	else {
+		e.nsPerEvaluation = measured;
+	}
+
+	nsPerNode += (measured / std::max<size_t>(e.compiledSize, 1) - nsPerNode) * NODE_SMOOTHING;
+}
@@ -1,19 +1,41 @@
 #include "functionFactory.hpp"
 
 #include <stdexcept>
-#include <fmt/base.h>
+#include <fmt/core.h>
 #include <cctype>
 #include <algorithm>
 #include <cmath>
+#include <numbers>
 
 #include "derivative.hpp"
+#include "tasks.hpp"
+#include "tracing.hpp"
+#include "allocationCounter.hpp"
+
+functionMapping standardFunctions() {
+	return {
+		{"sin", [](ld x) {return std::sin(x); }},
+		{"cos", [](ld x) {return std::cos(x); }},
+		{"log", [](ld x) {return std::log(x); }},
+		{"exp", [](ld x) {return std::exp(x); }},
+		{"logtwo", [](ld x) {return std::log2(x); }},
+		{"tan", [](ld x) {return std::tan(x); }},
+		{"pi", [](ld x) {return std::numbers::pi * x; }}
+	};
+}
 
 static int safeGet(std::map<std::string, int> map, std::string key, int placeholder = 0) {
 	auto res = map.find(key);
 	if (res == map.end()) return placeholder; else return res->second;
 }
 
-void FunctionFactory::tokenize(std::string& expression) {
+// letters, digits and underscores, a name starts with a letter
+static bool isNameChar(char c) {
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static void tokenize(const std::string& expression, std::vector<std::string>& tokens) {
+	tracing::Span span("tokenize");
 	std::string expressionNoSpaces;
 	for (char c : expression) {
 		if (c != ' ') {
@@ -59,7 +81,7 @@ void FunctionFactory::tokenize(std::string& expression) {
 			std::string identifier;
 			identifier += c;
 			size_t j = i + 1;
-			while (j < expressionNoSpaces.length() && (isalpha(expressionNoSpaces[j]) || expressionNoSpaces[j] == '\''))
+			while (j < expressionNoSpaces.length() && (isNameChar(expressionNoSpaces[j]) || expressionNoSpaces[j] == '\''))
 				identifier += expressionNoSpaces[j++];
 
 			if (j < expressionNoSpaces.length() && expressionNoSpaces[j] == '\'' && j + 1 < expressionNoSpaces.length() && expressionNoSpaces[j + 1] == '(') {
@@ -83,7 +105,22 @@ void FunctionFactory::tokenize(std::string& expression) {
 }
 
 
-void FunctionFactory::parse() {
+// names of the user functions an expression calls, found from its tokens alone
+static std::set<std::string> userCalls(const std::string& expression, const functionMapping& builtIns) {
+	std::vector<std::string> tokens;
+	tokenize(expression, tokens);
+	std::set<std::string> calls;
+	for (const std::string& token : tokens) {
+		std::string name = !token.empty() && token.back() == '\'' ? token.substr(0, token.size() - 1) : token;
+		if (!name.empty() && std::isalpha(static_cast<unsigned char>(name[0])) && name != "x" && builtIns.find(name) == builtIns.end()) {
+			calls.insert(name);
+		}
+	}
+	return calls;
+}
+
+static void parse(const std::vector<std::string>& tokens, std::vector<std::string>& parsed, std::vector<std::string>& operators) {
+	tracing::Span span("parse");
 	std::map<std::string, int> precedence = {
 		{"+", 1},
 		{"-", 1},
@@ -92,8 +129,6 @@ void FunctionFactory::parse() {
 		{"^", 3}
 	};
 
-	std::stack<std::string> operators;
-
 	size_t i = 0;
 	while (i < tokens.size()) {
 		std::string token = tokens[i];
@@ -112,76 +147,86 @@ void FunctionFactory::parse() {
 				}
 				return true;
 				}())) {
-			parsed.push(token);
+			parsed.push_back(token);
 		}
 		else if (!token.empty() &&
-			std::all_of(token.begin(), token.end(), [](char c) { return std::isalpha(c) or c == '\''; }) &&
+			std::all_of(token.begin(), token.end(), [](char c) { return isNameChar(c) or c == '\''; }) &&
 			token != "x" &&
 			i + 1 < tokens.size() &&
 			tokens[i + 1] == "(") {
-			operators.push(token);
+			operators.push_back(token);
 		}
 		else if (token == "(") {
-			operators.push(token);
+			operators.push_back(token);
 		}
 		else if (token == ")") {
-			while (!operators.empty() && operators.top() != "(") {
-				parsed.push(operators.top());
-				operators.pop();
+			while (!operators.empty() && operators.back() != "(") {
+				parsed.push_back(operators.back());
+				operators.pop_back();
 			}
 
-			if (!operators.empty() && operators.top() == "(") {
-				operators.pop();
+			if (!operators.empty() && operators.back() == "(") {
+				operators.pop_back();
 
 				if (!operators.empty() &&
-					std::all_of(operators.top().begin(), operators.top().end(),
-						[](char c) { return std::isalpha(c); }) &&
-					operators.top() != "x") {
-					parsed.push(operators.top());
-					operators.pop();
+					std::all_of(operators.back().begin(), operators.back().end(),
+						[](char c) { return isNameChar(c); }) &&
+					operators.back() != "x") {
+					parsed.push_back(operators.back());
+					operators.pop_back();
 				}
 			}
 		}
 		else if (precedence.find(token) != precedence.end()) {
 			while (!operators.empty() &&
-				operators.top() != "(" &&
-				precedence.find(operators.top()) == precedence.end()) {
-				parsed.push(operators.top());
-				operators.pop();
+				operators.back() != "(" &&
+				precedence.find(operators.back()) == precedence.end()) {
+				parsed.push_back(operators.back());
+				operators.pop_back();
 			}
 
 			while (!operators.empty() &&
-				operators.top() != "(" &&
-				precedence.find(operators.top()) != precedence.end() &&
-				((token != "^" && precedence[operators.top()] >= precedence[token]) ||
-					(token == "^" && precedence[operators.top()] > precedence[token]))) {
-				parsed.push(operators.top());
-				operators.pop();
+				operators.back() != "(" &&
+				precedence.find(operators.back()) != precedence.end() &&
+				((token != "^" && precedence[operators.back()] >= precedence[token]) ||
+					(token == "^" && precedence[operators.back()] > precedence[token]))) {
+				parsed.push_back(operators.back());
+				operators.pop_back();
 			}
 
-			operators.push(token);
+			operators.push_back(token);
 		}
 
 		i++;
 	}
 
 	while (!operators.empty()) {
-		parsed.push(operators.top());
-		operators.pop();
+		parsed.push_back(operators.back());
+		operators.pop_back();
 	}
 }
-Function FunctionFactory::buildFunction(char identifier) {
-	std::stack<Function> fnStack;
-
-	std::queue<std::string> parsedCopy = parsed;
+// a user function the expression may call, only those with a lower ID can be
+static const std::shared_ptr<const CompiledFunction>& userFunction(const std::string& name, const CompileContext& context, FunctionId& id) {
+	auto it = context.ids.find(name);
+	if (it == context.ids.end())
+		throw std::invalid_argument("Invalid function identifier: " + name);
+	if (it->second >= context.id)
+		throw std::invalid_argument("User-defined function calls must be to preceding or builtin functions");
+	if (it->second >= context.userFunctions.size() || !context.userFunctions[it->second])
+		throw std::invalid_argument("Function " + name + " is not defined");
+	id = it->second;
+	return context.userFunctions[id];
+}
 
-	while (!parsedCopy.empty()) {
-		std::string token = parsedCopy.front();
+static Function buildFunction(const std::vector<std::string>& parsed, std::vector<Function>& fnStack,
+	const CompileContext& context, std::set<FunctionId>& referenced, size_t& nodes) {
+	tracing::Span span("buildFunction");
 
-		parsedCopy.pop();
+	for (const std::string& token : parsed) {
+		nodes++;
 
 		if (token == "x") {
-			fnStack.push([](ld x) { return x; });
+			fnStack.push_back([](ld x) { return x; });
 		}
 		else if (!token.empty() && [&token]() {
 			try {
@@ -194,145 +239,335 @@ Function FunctionFactory::buildFunction(char identifier) {
 			}
 			}()) {
 			ld val = std::stold(token);
-			fnStack.push([val](ld x) { return val; });
+			fnStack.push_back([val](ld x) { return val; });
 		}
 		else if (token == "+") {
 			if (fnStack.size() < 2)
 				throw std::runtime_error("Expression parsing failed: not enough operands for +");
-			Function rhs = fnStack.top(); fnStack.pop();
-			Function lhs = fnStack.top(); fnStack.pop();
-			fnStack.push([lhs, rhs](ld x) { return lhs(x) + rhs(x); });
+			Function rhs = fnStack.back(); fnStack.pop_back();
+			Function lhs = fnStack.back(); fnStack.pop_back();
+			fnStack.push_back([lhs, rhs](ld x) { return lhs(x) + rhs(x); });
 		}
 		else if (token == "-") {
 			if (fnStack.size() < 2)
 				throw std::runtime_error("Expression parsing failed: not enough operands for -");
-			Function rhs = fnStack.top(); fnStack.pop();
-			Function lhs = fnStack.top(); fnStack.pop();
-			fnStack.push([lhs, rhs](ld x) { return lhs(x) - rhs(x); });
+			Function rhs = fnStack.back(); fnStack.pop_back();
+			Function lhs = fnStack.back(); fnStack.pop_back();
+			fnStack.push_back([lhs, rhs](ld x) { return lhs(x) - rhs(x); });
 		}
 		else if (token == "*") {
 			if (fnStack.size() < 2)
 				throw std::runtime_error("Expression parsing failed: not enough operands for *");
-			Function rhs = fnStack.top(); fnStack.pop();
-			Function lhs = fnStack.top(); fnStack.pop();
-			fnStack.push([lhs, rhs](ld x) { return lhs(x) * rhs(x); });
+			Function rhs = fnStack.back(); fnStack.pop_back();
+			Function lhs = fnStack.back(); fnStack.pop_back();
+			fnStack.push_back([lhs, rhs](ld x) { return lhs(x) * rhs(x); });
 		}
 		else if (token == "/") {
 			if (fnStack.size() < 2)
 				throw std::runtime_error("Expression parsing failed: not enough operands for /");
-			Function rhs = fnStack.top(); fnStack.pop();
-			Function lhs = fnStack.top(); fnStack.pop();
-			fnStack.push([lhs, rhs](ld x) { return lhs(x) / rhs(x); });
+			Function rhs = fnStack.back(); fnStack.pop_back();
+			Function lhs = fnStack.back(); fnStack.pop_back();
+			fnStack.push_back([lhs, rhs](ld x) { return lhs(x) / rhs(x); });
 		}
 		else if (token == "^") {
 			if (fnStack.size() < 2)
 				throw std::runtime_error("Expression parsing failed: not enough operands for ^");
-			Function rhs = fnStack.top(); fnStack.pop();
-			Function lhs = fnStack.top(); fnStack.pop();
-			fnStack.push([lhs, rhs](ld x) { return std::pow(lhs(x), rhs(x)); });
+			Function rhs = fnStack.back(); fnStack.pop_back();
+			Function lhs = fnStack.back(); fnStack.pop_back();
+			fnStack.push_back([lhs, rhs](ld x) { return std::pow(lhs(x), rhs(x)); });
 		}
 		else if (token.back() == '\'') {
 			if (fnStack.empty())
 				throw std::runtime_error("Illegal derivative: stack is empty");
 
-			Function arg = fnStack.top(); fnStack.pop();
+			Function arg = fnStack.back(); fnStack.pop_back();
 
 			std::string _identifier = token.substr(0, token.size() - 1);
 
-			if (_identifier.size() == 1 and _identifier[0] >= identifier)
-				throw std::invalid_argument("User-defined function calls must be to preceding or builtin functions");
-
 			Function fn;
-			auto builtinIt = builtInFunctions.find(_identifier);
-			if (builtinIt != builtInFunctions.end()) {
+			auto builtinIt = context.builtIns.find(_identifier);
+			if (builtinIt != context.builtIns.end()) {
 				fn = builtinIt->second;
 			}
 			else {
-				auto userIt = functions.find(_identifier);
-				if (userIt == functions.end())
-					throw std::invalid_argument("Invalid function identifier: " + _identifier);
-				fn = userIt->second;
+				FunctionId id;
+				const std::shared_ptr<const CompiledFunction>& callee = userFunction(_identifier, context, id);
+				// shared rather than copied, a copy would clone the callee's whole tree
+				fn = [callee](ld x) { return callee->fn(x); };
+				referenced.insert(id);
+				nodes += 2 * callee->size;
 			}
 
 			Function fn_prime = derivative(fn);
 
-			fnStack.push([fn_prime, arg](ld x) { ld z = arg(x); return fn_prime(z); });
+			fnStack.push_back([fn_prime, arg](ld x) { ld z = arg(x); return fn_prime(z); });
 		}
-		else if (std::all_of(token.begin(), token.end(), ::isalpha)) {
+		else if (std::all_of(token.begin(), token.end(), isNameChar)) {
 			if (fnStack.empty())
 				throw std::runtime_error("Function call requires an argument on the stack");
 
-			Function arg = fnStack.top(); fnStack.pop();
-
-			if (token.size() == 1 and token[0] >= identifier)
-				throw std::invalid_argument("User-defined function calls must be to preceding or builtin functions");
+			Function arg = fnStack.back(); fnStack.pop_back();
 
 			Function fn;
-			auto builtinIt = builtInFunctions.find(token);
-			if (builtinIt != builtInFunctions.end()) {
+			auto builtinIt = context.builtIns.find(token);
+			if (builtinIt != context.builtIns.end()) {
 				fn = builtinIt->second;
 			}
 			else {
-				auto userIt = functions.find(token);
-				if (userIt == functions.end())
-					throw std::invalid_argument("Invalid function identifier: " + token);
-				fn = userIt->second;
+				FunctionId id;
+				const std::shared_ptr<const CompiledFunction>& callee = userFunction(token, context, id);
+				fn = [callee](ld x) { return callee->fn(x); };
+				referenced.insert(id);
+				nodes += callee->size;
 			}
 
-			fnStack.push([fn, arg](ld x) { return fn(arg(x)); });
+			fnStack.push_back([fn, arg](ld x) { return fn(arg(x)); });
 		}
 	}
 
 	if (fnStack.empty())
 		throw std::runtime_error("Function construction failed: empty result");
 
-	return fnStack.top();
+	return fnStack.back();
+}
+std::shared_ptr<const CompiledFunction> compile(const std::string& expression, const CompileContext& context, CompileArena* arena) {
+	tracing::Span span("compile");
+	CompileArena local;
+	CompileArena& scratch = arena ? *arena : local;
+	scratch.tokens.clear();
+	scratch.parsed.clear();
+	scratch.operators.clear();
+	scratch.operands.clear();
+
+	tokenize(expression, scratch.tokens);
+	parse(scratch.tokens, scratch.parsed, scratch.operators);
+
+	auto compiled = std::make_shared<CompiledFunction>();
+	compiled->expression = expression;
+	compiled->fn = buildFunction(scratch.parsed, scratch.operands, context, compiled->references, compiled->size);
+	// the operands share the callees, the arena should not keep them alive
+	scratch.operands.clear();
+	return compiled;
+}
+std::pair<std::string, std::string> splitDefinition(const std::string& line) {
+	size_t equals = line.find('=');
+	if (equals == std::string::npos) {
+		if (line.empty()) return {};
+		return { line.substr(0, 1), line.substr(1) };
+	}
+
+	auto trim = [](const std::string& text) {
+		size_t first = text.find_first_not_of(' ');
+		if (first == std::string::npos) return std::string();
+		return text.substr(first, text.find_last_not_of(' ') - first + 1);
+		};
+	std::string name = trim(line.substr(0, equals));
+	if (name.size() > 3 && name.compare(name.size() - 3, 3, "(x)") == 0) name.resize(name.size() - 3);
+	return { trim(name), trim(line.substr(equals + 1)) };
+}
+
+// recomputes the revisions that include callees from the given ID on, callees always come first
+static void settleRevisions(FunctionSnapshot& snapshot, FunctionId from) {
+	for (FunctionId id = from; id < snapshot.size(); id++) {
+		uint64_t revision = snapshot.ownRevisions[id];
+		if (snapshot.functions[id]) {
+			for (FunctionId callee : snapshot.functions[id]->references) {
+				revision = std::max(revision, snapshot.revisions[callee]);
+			}
+		}
+		snapshot.revisions[id] = revision;
+	}
+}
+
+void FunctionFactory::checkName(const std::string& name) const {
+	if (name.empty() || !std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == 'x'
+		|| !std::all_of(name.begin(), name.end(), isNameChar)) {
+		throw std::invalid_argument("Invalid function name: " + name);
+	}
+	if (builtInFunctions.find(name) != builtInFunctions.end()) {
+		throw std::invalid_argument(name + " is a built-in function");
+	}
 }
 void FunctionFactory::loadFunctions(strvecr strfns)
 {
-	for (std::string str : strfns) {
-		char identifier = str[0];
-		std::string body = str.substr(1, str.size());
-		savedStrs[identifier] = body;
-		parseFunction(body, identifier);
+	if (strfns.empty()) return;
+	tracing::Span span("loadFunctions");
+	allocations::Scope allocationScope("parse");
+	std::lock_guard<std::mutex> lock(writer);
+	std::shared_ptr<const FunctionSnapshot> previous = current.load(std::memory_order_relaxed);
+
+	struct Definition {
+		std::string name;
+		std::string expression;
+		size_t line = 0;
+		FunctionId id = 0;
+		std::set<FunctionId> calls;
+		size_t level = 0;
+		std::shared_ptr<const CompiledFunction> compiled;
+		std::string error;
+	};
+
+	// a later definition of a name replaces an earlier one
+	std::vector<Definition> definitions;
+	std::unordered_map<std::string, size_t> latest;
+	for (size_t i = 0; i < strfns.size(); i++) {
+		auto [name, expression] = splitDefinition(strfns[i]);
+		auto [it, added] = latest.try_emplace(name, definitions.size());
+		if (added) definitions.emplace_back();
+		Definition& d = definitions[it->second];
+		d.name = std::move(name);
+		d.expression = std::move(expression);
+		d.line = i;
+	}
+	std::sort(definitions.begin(), definitions.end(), [](const Definition& a, const Definition& b) { return a.line < b.line; });
+
+	// new names are numbered in line order, so a line can call the lines above it
+	auto next = std::make_shared<FunctionSnapshot>(*previous);
+	for (Definition& d : definitions) {
+		try {
+			checkName(d.name);
+		}
+		catch (const std::exception& e) {
+			d.error = e.what();
+			continue;
+		}
+		auto [it, added] = next->ids.try_emplace(d.name, static_cast<FunctionId>(next->names.size()));
+		if (added) next->names.push_back(d.name);
+		d.id = it->second;
+	}
+	next->functions.resize(next->names.size());
+	next->ownRevisions.resize(next->names.size());
+	next->revisions.resize(next->names.size());
+
+	std::sort(definitions.begin(), definitions.end(), [](const Definition& a, const Definition& b) { return a.id < b.id; });
+	std::vector<size_t> position(next->names.size(), SIZE_MAX);
+	for (size_t i = 0; i < definitions.size(); i++) {
+		if (definitions[i].error.empty()) position[definitions[i].id] = i;
+	}
+
+	tasks::parallelFor(definitions.size(), tasks::Priority::Interactive, {}, [&](size_t i) {
+		Definition& d = definitions[i];
+		if (!d.error.empty()) return;
+		try {
+			for (const std::string& name : userCalls(d.expression, builtInFunctions)) {
+				auto it = next->ids.find(name);
+				if (it != next->ids.end()) d.calls.insert(it->second);
+			}
+		}
+		catch (const std::exception&) {
+			// compiling the line reports it
+		}
+		});
+
+	// calls only go to lower IDs, so one pass in ID order finds every level
+	size_t levelCount = 0;
+	for (Definition& d : definitions) {
+		if (!d.error.empty()) continue;
+		for (FunctionId dep : d.calls) {
+			if (dep < d.id && position[dep] != SIZE_MAX) d.level = std::max(d.level, definitions[position[dep]].level + 1);
+		}
+		levelCount = std::max(levelCount, d.level + 1);
+	}
+	std::vector<std::vector<size_t>> levels(levelCount);
+	for (size_t i = 0; i < definitions.size(); i++) {
+		if (definitions[i].error.empty()) levels[definitions[i].level].push_back(i);
+	}
+
+	// each level only calls into the ones before it, so its definitions compile independently
+	for (const std::vector<size_t>& level : levels) {
+		tasks::parallelFor(level.size(), tasks::Priority::Interactive, {}, [&](size_t k) {
+			Definition& d = definitions[level[k]];
+			for (FunctionId dep : d.calls) {
+				if (dep < d.id && position[dep] != SIZE_MAX && !definitions[position[dep]].compiled) {
+					d.error = fmt::format("calls {}, which failed to load", next->names[dep]);
+					return;
+				}
+			}
+			thread_local CompileArena scratch;
+			try {
+				d.compiled = compile(d.expression, { builtInFunctions, next->ids, next->functions, d.id }, &scratch);
+			}
+			catch (const std::exception& e) {
+				d.error = e.what();
+			}
+			});
+		for (size_t i : level) {
+			if (definitions[i].compiled) next->functions[definitions[i].id] = definitions[i].compiled;
+		}
+	}
+
+	// revisions follow the lines, as if they were defined one by one
+	std::sort(definitions.begin(), definitions.end(), [](const Definition& a, const Definition& b) { return a.line < b.line; });
+	std::string errors;
+	FunctionId changed = static_cast<FunctionId>(next->size());
+	for (const Definition& d : definitions) {
+		if (d.compiled) {
+			next->ownRevisions[d.id] = ++revisionCounter;
+			changed = std::min(changed, d.id);
+			continue;
+		}
+		if (!errors.empty()) errors += "; ";
+		errors += fmt::format("line {} ({}): {}", d.line + 1, d.name, d.error);
 	}
+	settleRevisions(*next, changed);
+	current.store(std::move(next), std::memory_order_release);
+
+	if (!errors.empty()) throw std::invalid_argument(errors);
 }
 FunctionFactory::FunctionFactory(functionMapping& fns) : builtInFunctions(fns) {};
 FunctionFactory::FunctionFactory(functionMapping& fns, strvecr strfns) : builtInFunctions(fns)
 {
 	loadFunctions(strfns);
 }
-const functionMapping& FunctionFactory::getFunctions() {
-	return functions;
-};
-void FunctionFactory::parseFunction(std::string expression, char identifier) 
+std::shared_ptr<const FunctionSnapshot> FunctionFactory::snapshot() const {
+	return current.load(std::memory_order_acquire);
+}
+FunctionId FunctionFactory::parseFunction(std::string expression, const std::string& name) 
 {
-	try {
-	tokenize(expression);
-	parse();
-
-	Function fn = buildFunction(identifier);
-	functions[std::string() + identifier] = fn;
-	savedStrs[identifier] = expression;
-
-	parsed = std::queue<std::string>();
-	tokens = std::vector<std::string>();
-	}
-	catch (std::exception& e) {
-		parsed = std::queue<std::string>();
-		tokens = std::vector<std::string>();
-		throw e;
+	tracing::Span span("parseFunction");
+	allocations::Scope allocationScope("parse");
+	checkName(name);
+	std::lock_guard<std::mutex> lock(writer);
+	std::shared_ptr<const FunctionSnapshot> previous = current.load(std::memory_order_relaxed);
+	std::optional<FunctionId> existing = previous->find(name);
+	FunctionId id = existing.value_or(static_cast<FunctionId>(previous->size()));
+	std::shared_ptr<const CompiledFunction> fn = compile(expression, { builtInFunctions, previous->ids, previous->functions, id }, &arena);
+
+	auto next = std::make_shared<FunctionSnapshot>(*previous);
+	if (!existing.has_value()) {
+		next->ids[name] = id;
+		next->names.push_back(name);
+		next->functions.emplace_back();
+		next->ownRevisions.push_back(0);
+		next->revisions.push_back(0);
 	}
+	next->functions[id] = fn;
+	next->ownRevisions[id] = ++revisionCounter;
+	settleRevisions(*next, id);
+	current.store(std::move(next), std::memory_order_release);
+	return id;
 }
-std::vector<std::string> FunctionFactory::exportFunctions()
+std::vector<std::string> FunctionFactory::exportFunctions() const
 {
+	std::shared_ptr<const FunctionSnapshot> functions = snapshot();
 	std::vector<std::string> res;
-	for (auto pair : savedStrs) {
-		res.push_back(pair.first + pair.second);
+	for (FunctionId id = 0; id < functions->size(); id++) {
+		if (!functions->functions[id]) continue;
+		res.push_back(fmt::format("{}(x) = {}", functions->names[id], functions->functions[id]->expression));
 	}
-	sortStrVecByFirstChar(res);
 	return res;
 };
 void FunctionFactory::importFunctions(strvecr fnstrs) {
 	loadFunctions(fnstrs);
+}
+std::optional<FunctionId> FunctionSnapshot::find(const std::string& name) const {
+	auto it = ids.find(name);
+	if (it == ids.end()) return std::nullopt;
+	return it->second;
+}
+uint64_t FunctionSnapshot::revision(FunctionId id) const {
+	return id < revisions.size() ? revisions[id] : 0;
+}
+size_t FunctionSnapshot::compiledSize(FunctionId id) const {
+	return id < functions.size() && functions[id] ? functions[id]->size : 0;
 }
\ No newline at end of file
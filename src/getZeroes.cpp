@@ -1,13 +1,18 @@
 #include "getZeroes.hpp"
 #include "derivative.hpp"
+#include "tracing.hpp"
+#include "allocationCounter.hpp"
+#include "tasks.hpp"
+#include <atomic>
 #include <vector>
 #include <cmath>
 #include <limits>
 #include <algorithm>
 
-std::vector<ld> getZeroes(Function fn) {
+tasks::Status getZeroes(Function fn, std::vector<ld>& roots, const tasks::Cancellation& cancellation) {
+    tracing::Span span("getZeroes");
+    allocations::Scope allocationScope("roots");
 
-    std::vector<ld> roots;
     Function dfn = derivative(fn);
 
     const ld EPSILON = 1e-10;        
@@ -15,41 +20,64 @@ std::vector<ld> getZeroes(Function fn) {
     const ld DOMAIN_MIN = -50.0;     
     const ld DOMAIN_MAX = 50.0;      
     const int NUM_STARTING_POINTS = 200000; 
+    const int CHUNKS = 64;
+    const int CHECK_INTERVAL = 256; // starting points between two cancellation checks
 
-    
-    for (int i = 0; i < NUM_STARTING_POINTS; i++) {
+    // Newton runs from the starting points are split into chunks on the shared pool, the
+    // duplicates are then dropped in starting point order exactly as a single pass would
+    std::vector<std::vector<ld>> candidates(CHUNKS);
+    std::atomic<tasks::Status> stopped = tasks::Status::Complete;
+    tasks::Status status = tasks::parallelFor(CHUNKS, tasks::Priority::Interactive, cancellation, [&](size_t chunk) {
+        int first = static_cast<int>(static_cast<long long>(NUM_STARTING_POINTS) * chunk / CHUNKS);
+        int last = static_cast<int>(static_cast<long long>(NUM_STARTING_POINTS) * (chunk + 1) / CHUNKS);
+        for (int i = first; i < last; i++) {
+            if ((i - first) % CHECK_INTERVAL == CHECK_INTERVAL - 1) {
+                tasks::Status check = cancellation.status();
+                if (check != tasks::Status::Complete) {
+                    stopped = check;
+                    return;
+                }
+            }
         
-        ld x = DOMAIN_MIN + (DOMAIN_MAX - DOMAIN_MIN) * i / (NUM_STARTING_POINTS - 1);
+            ld x = DOMAIN_MIN + (DOMAIN_MAX - DOMAIN_MIN) * i / (NUM_STARTING_POINTS - 1);
 
-        bool converged = false;
-        for (int iter = 0; iter < MAX_ITERATIONS; iter++) {
-            ld fx = fn(x);
-            ld dfx = dfn(x);
+            bool converged = false;
+            for (int iter = 0; iter < MAX_ITERATIONS; iter++) {
+                ld fx = fn(x);
+                ld dfx = dfn(x);
             
-            if (std::abs(fx) < EPSILON) {
-                converged = true;
-                break;
-            }
+                if (std::abs(fx) < EPSILON) {
+                    converged = true;
+                    break;
+                }
 
-            if (std::abs(dfx) < EPSILON) { // nie dzielimy przez strasznie male liczby, bo by dawaly bardzo glupie wyniki (punkt przeciecia osi OX z styczna x^2 dla x~=0)
-                break;
-            }
+                if (std::abs(dfx) < EPSILON) { // nie dzielimy przez strasznie male liczby, bo by dawaly bardzo glupie wyniki (punkt przeciecia osi OX z styczna x^2 dla x~=0)
+                    break;
+                }
 
-            ld delta = fx / dfx;
-            x = x - delta;
+                ld delta = fx / dfx;
+                x = x - delta;
             
-            if (x < DOMAIN_MIN || x > DOMAIN_MAX) {
-                break;
-            }
+                if (x < DOMAIN_MIN || x > DOMAIN_MAX) {
+                    break;
+                }
             
-            if (std::abs(delta) < EPSILON) {
-                converged = true;
-                break;
+                if (std::abs(delta) < EPSILON) {
+                    converged = true;
+                    break;
+                }
             }
-        }
         
-        if (converged) {
-            
+            if (converged) {
+                candidates[chunk].push_back(x);
+            }
+        }
+        });
+    if (status == tasks::Status::Complete) status = stopped;
+
+    roots.clear();
+    for (const std::vector<ld>& chunk : candidates) {
+        for (ld x : chunk) {
             bool isDuplicate = false;
             for (ld root : roots) {
                 if (std::abs(root - x) < EPSILON) {
@@ -66,5 +94,5 @@ std::vector<ld> getZeroes(Function fn) {
 
     std::sort(roots.begin(), roots.end());
 
-    return roots;
+    return status;
 }
\ No newline at end of file
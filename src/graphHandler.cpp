@@ -1,9 +1,36 @@
 #include "graphHandler.hpp"
-
+#include "profiler.hpp"
+#include "tracing.hpp"
+#include "allocationCounter.hpp"
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include <fmt/core.h>
 
 
 namespace graph{
+    SDL_Color functionColor(FunctionId id) {
+        if (id < FUNCTION_COLORS.size()) return FUNCTION_COLORS[id];
+
+        // fully saturated hues are reserved for the fixed palette, these are a little softer
+        double hue = std::fmod(id * 137.50776, 360.0) / 60.0;
+        double saturation = 0.7;
+        double x = 1.0 - std::abs(std::fmod(hue, 2.0) - 1.0);
+        double r = 0.0, g = 0.0, b = 0.0;
+        switch (static_cast<int>(hue)) {
+        case 0: r = 1.0; g = x; break;
+        case 1: r = x; g = 1.0; break;
+        case 2: g = 1.0; b = x; break;
+        case 3: g = x; b = 1.0; break;
+        case 4: r = x; b = 1.0; break;
+        default: r = 1.0; b = x; break;
+        }
+        auto channel = [&](double c) { return static_cast<Uint8>(std::lround(255.0 * (1.0 - saturation * (1.0 - c)))); };
+        return { channel(r), channel(g), channel(b), 255 };
+    }
+
     int mapX(double x, double minX, double maxX, int screenWidth) {
         return static_cast<int>((x - minX) / (maxX - minX) * screenWidth);
     }
@@ -27,17 +54,19 @@ namespace graph{
         }
     }
 
-    void drawAxes(SDL_Renderer* renderer, double minX, double maxX, double minY, double maxY,
-        int screenWidth, int screenHeight, const char* fontPath) {
-        
-        SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+    void axesLayout(double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, std::vector<Segment>& segments, std::vector<Label>& labels) {
+
+        const SDL_Color axisColor = { 128, 128, 128, 255 };
+        const SDL_Color tickColor = { 100, 100, 100, 255 };
+
         if (minY <= 0 && maxY >= 0) {
             int y0 = mapY(0, minY, maxY, screenHeight);
-            SDL_RenderDrawLine(renderer, 0, y0, screenWidth, y0);
+            segments.push_back({ 0, y0, screenWidth, y0, axisColor });
         }
         if (minX <= 0 && maxX >= 0) {
             int x0 = mapX(0, minX, maxX, screenWidth);
-            SDL_RenderDrawLine(renderer, x0, 0, x0, screenHeight);
+            segments.push_back({ x0, 0, x0, screenHeight, axisColor });
         }
 
         
@@ -73,72 +102,39 @@ namespace graph{
         double yStart = std::ceil(minY / yStep) * yStep;
 
         
-        TTF_Font* font = TTF_OpenFont(fontPath, 10);
-        SDL_Color textColor = { 255, 255, 255, 255 };
-
-        
         for (double x = xStart; x <= maxX; x += xStep) {
             if (fabs(x) < 1e-10) continue; 
             int screenX = mapX(x, minX, maxX, screenWidth);
-            SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
             int axisY = (minY <= 0 && maxY >= 0) ? mapY(0, minY, maxY, screenHeight) : screenHeight - 20;
-            SDL_RenderDrawLine(renderer, screenX, axisY - 5, screenX, axisY + 5);
-
-            
-            std::string label = fmt::format("{0:.{1}f}", x, xPrecision);
-
-
-            if (font) {
-                SDL_Surface* surface = TTF_RenderText_Solid(font, label.c_str(), textColor);
-                if (surface) {
-                    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    if (texture) {
-                        SDL_Rect dest = { screenX - surface->w / 2, axisY + 8, surface->w, surface->h };
-                        SDL_RenderCopy(renderer, texture, NULL, &dest);
-                        SDL_DestroyTexture(texture);
-                    }
-                    SDL_FreeSurface(surface);
-                }
-            }
+            segments.push_back({ screenX, axisY - 5, screenX, axisY + 5, tickColor });
+
+            Label& label = labels.emplace_back();
+            auto written = fmt::format_to_n(label.text, sizeof(label.text), "{0:.{1}f}", x, xPrecision);
+            label.length = std::min(written.size, sizeof(label.text));
+            label.x = screenX;
+            label.y = axisY + 8;
+            label.anchor = Label::Anchor::Top;
         }
 
         
         for (double y = yStart; y <= maxY; y += yStep) {
             if (fabs(y) < 1e-10) continue; 
             int screenY = mapY(y, minY, maxY, screenHeight);
-            SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
             int axisX = (minX <= 0 && maxX >= 0) ? mapX(0, minX, maxX, screenWidth) : 32;
-            SDL_RenderDrawLine(renderer, axisX - 5, screenY, axisX + 5, screenY);
-
-            
-            std::string label = fmt::format("{0:.{1}f}", y, yPrecision);
-
-
-            if (font) {
-                SDL_Surface* surface = TTF_RenderText_Solid(font, label.c_str(), textColor);
-                if (surface) {
-                    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    if (texture) {
-                        SDL_Rect dest = { axisX - surface->w - 8, screenY - surface->h / 2, surface->w, surface->h };
-                        SDL_RenderCopy(renderer, texture, NULL, &dest);
-                        SDL_DestroyTexture(texture);
-                    }
-                    SDL_FreeSurface(surface);
-                }
-            }
-        }
-
-        
-        if (font) {
-            TTF_CloseFont(font);
+            segments.push_back({ axisX - 5, screenY, axisX + 5, screenY, tickColor });
+
+            Label& label = labels.emplace_back();
+            auto written = fmt::format_to_n(label.text, sizeof(label.text), "{0:.{1}f}", y, yPrecision);
+            label.length = std::min(written.size, sizeof(label.text));
+            label.x = axisX - 8;
+            label.y = screenY;
+            label.anchor = Label::Anchor::Right;
         }
     }
 
-
-
-    void drawGrid(SDL_Renderer* renderer, double minX, double maxX, double minY, double maxY,
-        int screenWidth, int screenHeight) {
-        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+    void gridLayout(double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, std::vector<Segment>& segments) {
+        const SDL_Color gridColor = { 50, 50, 50, 255 };
 
         
         double xRange = maxX - minX;
@@ -158,7 +154,7 @@ namespace graph{
             if (fabs(x) < 1e-10) continue;
 
             int screenX = mapX(x, minX, maxX, screenWidth);
-            SDL_RenderDrawLine(renderer, screenX, 0, screenX, screenHeight);
+            segments.push_back({ screenX, 0, screenX, screenHeight, gridColor });
         }
 
         
@@ -167,54 +163,250 @@ namespace graph{
             if (fabs(y) < 1e-10) continue;
 
             int screenY = mapY(y, minY, maxY, screenHeight);
-            SDL_RenderDrawLine(renderer, 0, screenY, screenWidth, screenY);
+            segments.push_back({ 0, screenY, screenWidth, screenY, gridColor });
         }
     }
 
+    static void drawSegments(SDL_Renderer* renderer, const std::vector<Segment>& segments) {
+        for (const Segment& s : segments) {
+            SDL_SetRenderDrawColor(renderer, s.color.r, s.color.g, s.color.b, s.color.a);
+            SDL_RenderDrawLine(renderer, s.x0, s.y0, s.x1, s.y1);
+        }
+    }
 
-    void plotFunction(SDL_Renderer* renderer, Function& func,
-        double minX, double maxX, double minY, double maxY,
-        int screenWidth, int screenHeight, SDL_Color color) {
+    void drawAxes(SDL_Renderer* renderer, double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, TextRenderer& text) {
+        tracing::Span span("drawAxes");
+
+        thread_local std::vector<Segment> segments;
+        thread_local std::vector<Label> labels;
+        segments.clear();
+        labels.clear();
+        axesLayout(minX, maxX, minY, maxY, screenWidth, screenHeight, segments, labels);
+        drawSegments(renderer, segments);
+
+        const SDL_Color textColor = { 255, 255, 255, 255 };
+        int labelHeight = text.lineHeight(LABEL_SIZE);
+        for (const Label& label : labels) {
+            std::string_view labelText = label.view();
+            int width = text.measure(labelText, LABEL_SIZE);
+            if (label.anchor == Label::Anchor::Top) {
+                text.draw(labelText, label.x - width / 2, label.y, LABEL_SIZE, textColor);
+            }
+            else {
+                text.draw(labelText, label.x - width, label.y - labelHeight / 2, LABEL_SIZE, textColor);
+            }
+        }
 
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        text.flush();
+    }
 
-        const int numPoints = screenWidth * 2;
-        double step = (maxX - minX) / numPoints;
+    void drawGrid(SDL_Renderer* renderer, double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight) {
+        thread_local std::vector<Segment> segments;
+        segments.clear();
+        gridLayout(minX, maxX, minY, maxY, screenWidth, screenHeight, segments);
+        drawSegments(renderer, segments);
+    }
 
-        std::vector<SDL_Point> points;
-        bool lastPointValid = false;
-        SDL_Point lastPoint = { 0, 0 };
 
-        for (int i = 0; i <= numPoints; i++) {
-            double x = minX + i * step;
-            double y;
+    void toScreen(const double* xs, const double* ys, size_t count,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, SDL_FPoint* out) {
 
-            try {
-                y = func(x);
+        // same mapping as mapX/mapY, with the divisions hoisted so the loop vectorizes
+        const double scaleX = screenWidth / (maxX - minX);
+        const double offsetX = -minX * scaleX;
+        const double scaleY = -screenHeight / (maxY - minY);
+        const double offsetY = screenHeight - minY * scaleY;
 
-                bool pointValid = y >= minY && y <= maxY &&
-                    !std::isinf(y) && !std::isnan(y);
+        for (size_t i = 0; i < count; i++) {
+            out[i].x = static_cast<float>(xs[i] * scaleX + offsetX);
+            out[i].y = static_cast<float>(ys[i] * scaleY + offsetY);
+        }
+    }
 
-                if (pointValid) {
-                    SDL_Point point = {
-                        mapX(x, minX, maxX, screenWidth),
-                        mapY(y, minY, maxY, screenHeight)
-                    };
+    void reproject(const SDL_FPoint* points, size_t count,
+        double fromMinX, double fromMaxX, double fromMinY, double fromMaxY, int fromWidth, int fromHeight,
+        double minX, double maxX, double minY, double maxY, int screenWidth, int screenHeight, SDL_FPoint* out) {
 
-                    if (lastPointValid) {
-                        SDL_RenderDrawLine(renderer, lastPoint.x, lastPoint.y, point.x, point.y);
-                    }
+        // both mappings are affine, so is going from one to the other
+        const double scaleX = (fromMaxX - fromMinX) / fromWidth * screenWidth / (maxX - minX);
+        const double offsetX = (fromMinX - minX) * screenWidth / (maxX - minX);
+        const double scaleY = (fromMaxY - fromMinY) / fromHeight * screenHeight / (maxY - minY);
+        const double offsetY = screenHeight - (fromMinY - minY + (fromMaxY - fromMinY)) * screenHeight / (maxY - minY);
+
+        for (size_t i = 0; i < count; i++) {
+            out[i].x = static_cast<float>(points[i].x * scaleX + offsetX);
+            out[i].y = static_cast<float>(points[i].y * scaleY + offsetY);
+        }
+    }
+
+    void drawPolylines(SDL_Renderer* renderer, const SDL_FPoint* points, const double* ys, size_t count,
+        double minY, double maxY) {
 
-                    lastPoint = point;
-                    lastPointValid = true;
+        size_t runStart = 0;
+        for (size_t i = 0; i <= count; i++) {
+            bool valid = i < count && ys[i] >= minY && ys[i] <= maxY;
+            if (!valid) {
+                if (i - runStart >= 2) {
+                    SDL_RenderDrawLinesF(renderer, points + runStart, static_cast<int>(i - runStart));
                 }
-                else {
-                    lastPointValid = false;
+                runStart = i + 1;
+            }
+        }
+    }
+
+    void buildStroke(const SDL_FPoint* points, const double* ys, size_t count, double minY, double maxY,
+        float lineWidth, SDL_Color color, std::vector<SDL_Vertex>& vertices, std::vector<int>& indices) {
+        const float MITER_LIMIT = 4.0f;
+        const float inner = std::max(lineWidth, 1.0f) / 2.0f - 0.5f;
+        const float outer = inner + 1.0f;
+        SDL_Color core = color;
+        core.a = static_cast<Uint8>(color.a * std::min(lineWidth, 1.0f));
+        SDL_Color edge = color;
+        edge.a = 0;
+
+        thread_local std::vector<SDL_FPoint> run;
+        size_t runStart = 0;
+        for (size_t i = 0; i <= count; i++) {
+            bool valid = i < count && ys[i] >= minY && ys[i] <= maxY;
+            if (valid) continue;
+
+            // consecutive points closer than a hundredth of a pixel have no direction
+            run.clear();
+            for (size_t j = runStart; j < i; j++) {
+                if (!run.empty() && std::abs(points[j].x - run.back().x) < 0.01f && std::abs(points[j].y - run.back().y) < 0.01f) continue;
+                run.push_back(points[j]);
+            }
+            runStart = i + 1;
+            if (run.size() < 2) continue;
+
+            auto normal = [&](size_t segment) {
+                float dx = run[segment + 1].x - run[segment].x;
+                float dy = run[segment + 1].y - run[segment].y;
+                float length = std::sqrt(dx * dx + dy * dy);
+                return SDL_FPoint{ -dy / length, dx / length };
+                };
+
+            int base = static_cast<int>(vertices.size());
+            for (size_t j = 0; j < run.size(); j++) {
+                SDL_FPoint n = normal(j == run.size() - 1 ? j - 1 : j);
+                if (j > 0 && j < run.size() - 1) {
+                    SDL_FPoint previous = normal(j - 1);
+                    SDL_FPoint miter = { previous.x + n.x, previous.y + n.y };
+                    float length = std::sqrt(miter.x * miter.x + miter.y * miter.y);
+                    if (length > 1e-3f) {
+                        // lengthen the averaged normal so both segments keep their width at the joint
+                        float scale = std::min(2.0f / length, MITER_LIMIT) / length;
+                        n = { miter.x * scale, miter.y * scale };
+                    }
                 }
+
+                const SDL_FPoint& p = run[j];
+                vertices.push_back({ { p.x + n.x * outer, p.y + n.y * outer }, edge, { 0, 0 } });
+                vertices.push_back({ { p.x + n.x * inner, p.y + n.y * inner }, core, { 0, 0 } });
+                vertices.push_back({ { p.x - n.x * inner, p.y - n.y * inner }, core, { 0, 0 } });
+                vertices.push_back({ { p.x - n.x * outer, p.y - n.y * outer }, edge, { 0, 0 } });
             }
-            catch (...) {
-                lastPointValid = false;
+
+            for (size_t j = 0; j + 1 < run.size(); j++) {
+                int a = base + static_cast<int>(j) * 4;
+                int b = a + 4;
+                for (int k = 0; k < 3; k++) {
+                    indices.insert(indices.end(), { a + k, a + k + 1, b + k + 1, a + k, b + k + 1, b + k });
+                }
             }
         }
     }
+
+    void drawStroke(SDL_Renderer* renderer, const SDL_FPoint* points, const double* ys, size_t count,
+        double minY, double maxY, float lineWidth, SDL_Color color) {
+        thread_local std::vector<SDL_Vertex> vertices;
+        thread_local std::vector<int> indices;
+        vertices.clear();
+        indices.clear();
+        buildStroke(points, ys, count, minY, maxY, lineWidth, color, vertices, indices);
+        if (indices.empty()) return;
+
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_RenderGeometry(renderer, NULL,
+            vertices.data(), static_cast<int>(vertices.size()),
+            indices.data(), static_cast<int>(indices.size()));
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    }
+
+    void drawCurve(SDL_Renderer* renderer, const std::vector<double>& xs, const std::vector<double>& ys,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, SDL_Color color, float lineWidth) {
+        thread_local std::vector<SDL_FPoint> points;
+
+        points.resize(xs.size());
+        toScreen(xs.data(), ys.data(), xs.size(), minX, maxX, minY, maxY, screenWidth, screenHeight, points.data());
+        drawCurve(renderer, points.data(), ys.data(), points.size(), minY, maxY, color, lineWidth);
+    }
+
+    void drawCurve(SDL_Renderer* renderer, const SDL_FPoint* points, const double* ys, size_t count,
+        double minY, double maxY, SDL_Color color, float lineWidth) {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        if (lineWidth > 0.0f) {
+            drawStroke(renderer, points, ys, count, minY, maxY, lineWidth, color);
+        }
+        else {
+            drawPolylines(renderer, points, ys, count, minY, maxY);
+        }
+    }
+
+    void plotFunction(SDL_Renderer* renderer, const Function& func,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, SDL_Color color, float lineWidth, sampler::SampleCache* cache, int slot) {
+        tracing::Span span("plotFunction");
+        static allocations::Operation& evaluateOperation = allocations::operation("evaluate");
+        allocations::Scope allocationScope(evaluateOperation);
+
+        const size_t budget = sampleBudget(screenWidth);
+
+        // reused across calls so a steady frame does not allocate
+        thread_local std::vector<double> xs;
+        thread_local std::vector<double> ys;
+
+        size_t evaluations = sampler::sampleAdaptive(func, minX, maxX, minY, maxY,
+            screenWidth, screenHeight, budget, xs, ys, cache, slot);
+        drawCurve(renderer, xs, ys, minX, maxX, minY, maxY, screenWidth, screenHeight, color, lineWidth);
+
+        profiler::countEvaluations(evaluations);
+    }
+
+    void plotEnvelope(SDL_Renderer* renderer, const Function& func,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, SDL_Color color) {
+        tracing::Span span("plotEnvelope");
+        static allocations::Operation& evaluateOperation = allocations::operation("evaluate");
+        allocations::Scope allocationScope(evaluateOperation);
+
+        // fixed cost per column, independent of how fast the function oscillates
+        const int SAMPLES_PER_COLUMN = 8;
+
+        thread_local std::vector<double> lows;
+        thread_local std::vector<double> highs;
+        thread_local std::vector<SDL_FRect> spans;
+
+        size_t evaluations = sampler::sampleEnvelope(func, minX, maxX, screenWidth, SAMPLES_PER_COLUMN, lows, highs);
+
+        const double scaleY = -screenHeight / (maxY - minY);
+        const double offsetY = screenHeight - minY * scaleY;
+
+        spans.clear();
+        for (int c = 0; c < screenWidth; c++) {
+            if (!(highs[c] >= minY && lows[c] <= maxY)) continue;
+            float top = static_cast<float>(std::min(highs[c], maxY) * scaleY + offsetY);
+            float bottom = static_cast<float>(std::max(lows[c], minY) * scaleY + offsetY);
+            spans.push_back({ static_cast<float>(c), top, 1.0f, std::max(1.0f, bottom - top) });
+        }
+
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRectsF(renderer, spans.data(), static_cast<int>(spans.size()));
+
+        profiler::countEvaluations(evaluations);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "headless.hpp"
+#include "graphHandler.hpp"
+#include "functionFactory.hpp"
+#include "fileHandler.hpp"
+#include "imageWriter.hpp"
+#include "raster.hpp"
+#include "tracing.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace headless {
+
+    void parseView(const std::string& view, Job& job) {
+        std::stringstream stream(view);
+        std::string part;
+        std::vector<double> values;
+        while (std::getline(stream, part, ',')) {
+            try {
+                size_t used = 0;
+                values.push_back(std::stod(part, &used));
+                if (used != part.size()) throw std::invalid_argument(part);
+            }
+            catch (const std::exception&) {
+                throw std::invalid_argument("Invalid view \"" + view + "\", expected x0,x1,y0,y1");
+            }
+        }
+        if (values.size() != 4 || values[0] >= values[1] || values[2] >= values[3]) {
+            throw std::invalid_argument("Invalid view \"" + view + "\", expected x0,x1,y0,y1 with x0 < x1 and y0 < y1");
+        }
+        job.minX = values[0];
+        job.maxX = values[1];
+        job.minY = values[2];
+        job.maxY = values[3];
+    }
+
+    std::vector<Job> jobsFromArguments(const std::vector<std::string>& outPaths,
+        const std::vector<std::string>& views, const std::optional<std::string>& functionsPath) {
+        if (views.size() > 1 && views.size() != outPaths.size()) {
+            throw std::invalid_argument("Got " + std::to_string(views.size()) + " views for "
+                + std::to_string(outPaths.size()) + " outputs");
+        }
+
+        std::vector<Job> jobs;
+        for (size_t i = 0; i < outPaths.size(); i++) {
+            Job job;
+            job.outPath = outPaths[i];
+            job.functionsPath = functionsPath;
+            if (!views.empty()) parseView(views[views.size() == 1 ? 0 : i], job);
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+
+    std::vector<Job> loadJobs(const std::string& path, const std::optional<std::string>& functionsPath) {
+        std::ifstream file(path, std::ios::in);
+        if (!file.good()) {
+            throw std::runtime_error("Cannot open batch file at path: " + path);
+        }
+
+        std::vector<Job> jobs;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+
+            std::stringstream stream(line);
+            std::string out, view, functions;
+            if (!(stream >> out)) continue;
+
+            Job job;
+            job.outPath = out;
+            job.functionsPath = functionsPath;
+            try {
+                if (!(stream >> view)) throw std::invalid_argument("missing view");
+                parseView(view, job);
+            }
+            catch (const std::exception& ex) {
+                throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + ex.what());
+            }
+            if (stream >> functions) job.functionsPath = functions;
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+
+    int run(const std::vector<Job>& jobs, int width, int height, const std::string& fontPath, float lineWidth,
+        const tasks::Cancellation& cancellation) {
+        tracing::Span span("headless");
+
+        TTF_Init();
+        int failures = 0;
+        {
+            raster::Font font(fontPath, graph::LABEL_SIZE);
+            if (!font.ready()) {
+                std::cerr << "Failed to load font, axis labels are skipped: " << TTF_GetError() << std::endl;
+            }
+
+            std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+            functionMapping builtIns = standardFunctions();
+            std::map<std::string, std::unique_ptr<FunctionFactory>> factories;
+            std::vector<raster::Curve> curves;
+
+            size_t skipped = 0;
+            tasks::Status stopped = tasks::Status::Complete;
+            for (const Job& job : jobs) {
+                if (stopped == tasks::Status::Complete) stopped = cancellation.status();
+                if (stopped != tasks::Status::Complete) {
+                    skipped++;
+                    continue;
+                }
+
+                tracing::Span jobSpan("headlessJob");
+                try {
+                    std::string key = job.functionsPath.value_or("");
+                    auto it = factories.find(key);
+                    if (it == factories.end()) {
+                        std::vector<std::string> loaded;
+                        if (job.functionsPath.has_value()) loaded = fileHandler::loadFunctions(job.functionsPath.value());
+                        it = factories.emplace(key, std::make_unique<FunctionFactory>(builtIns, loaded)).first;
+                    }
+
+                    curves.clear();
+                    std::shared_ptr<const FunctionSnapshot> registry = it->second->snapshot();
+                    for (FunctionId id = 0; id < registry->size(); id++) {
+                        if (!registry->functions[id]) continue;
+                        curves.push_back({ &registry->functions[id]->fn, graph::functionColor(id) });
+                    }
+
+                    tasks::Status status = raster::render(pixels.data(), width * 4, width, height,
+                        job.minX, job.maxX, job.minY, job.maxY, curves, &font, 0, lineWidth, cancellation);
+                    if (status != tasks::Status::Complete) {
+                        std::cerr << job.outPath << ": " << tasks::describe(status) << ", not written" << std::endl;
+                        stopped = status;
+                        failures++;
+                        continue;
+                    }
+                    image::save(job.outPath, pixels.data(), width, height, width * 4);
+                }
+                catch (const std::exception& ex) {
+                    std::cerr << job.outPath << ": " << ex.what() << std::endl;
+                    failures++;
+                }
+            }
+            if (skipped > 0) {
+                std::cerr << skipped << " of " << jobs.size() << " images skipped, run " << tasks::describe(stopped) << std::endl;
+                failures++;
+            }
+        }
+        TTF_Quit();
+
+        return failures == 0 ? 0 : 1;
+    }
+
+}
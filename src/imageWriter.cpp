@@ -0,0 +1,241 @@
+#include "imageWriter.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    const size_t WINDOW_SIZE = 32768;
+    const size_t MIN_MATCH = 3;
+    const size_t MAX_MATCH = 258;
+    const int HASH_BITS = 15;
+
+    class BitWriter {
+    private:
+        std::vector<uint8_t>& out;
+        uint32_t buffer = 0;
+        int count = 0;
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        // deflate packs values least significant bit first
+        void put(uint32_t value, int bits) {
+            buffer |= value << count;
+            count += bits;
+            while (count >= 8) {
+                out.push_back(static_cast<uint8_t>(buffer));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        // ...but Huffman codes most significant bit first
+        void putCode(uint32_t code, int bits) {
+            uint32_t reversed = 0;
+            for (int i = 0; i < bits; i++) {
+                reversed = (reversed << 1) | ((code >> i) & 1);
+            }
+            put(reversed, bits);
+        }
+
+        void flush() {
+            if (count > 0) out.push_back(static_cast<uint8_t>(buffer));
+            buffer = 0;
+            count = 0;
+        }
+    };
+
+    void putLiteral(BitWriter& bits, int symbol) {
+        if (symbol < 144) bits.putCode(0x30 + symbol, 8);
+        else if (symbol < 256) bits.putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) bits.putCode(symbol - 256, 7);
+        else bits.putCode(0xC0 + symbol - 280, 8);
+    }
+
+    void putMatch(BitWriter& bits, size_t length, size_t distance) {
+        int l = 28;
+        while (LENGTH_BASE[l] > length) l--;
+        putLiteral(bits, 257 + l);
+        bits.put(static_cast<uint32_t>(length - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+
+        int d = 29;
+        while (DISTANCE_BASE[d] > distance) d--;
+        bits.putCode(d, 5);
+        bits.put(static_cast<uint32_t>(distance - DISTANCE_BASE[d]), DISTANCE_EXTRA[d]);
+    }
+
+    // Single fixed-Huffman block with greedy LZ77 over a hash of the last position of each
+    // three byte prefix. Plots are mostly flat background, so long runs dominate and keep
+    // the output small without a zlib dependency.
+    std::vector<uint8_t> deflate(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out;
+        out.reserve(data.size() / 8 + 64);
+        BitWriter bits(out);
+        bits.put(1, 1); // final block
+        bits.put(1, 2); // fixed Huffman codes
+
+        std::vector<int64_t> head(size_t(1) << HASH_BITS, -1);
+        auto hash = [&](size_t i) {
+            uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+            return (v * 2654435761u) >> (32 - HASH_BITS);
+            };
+
+        size_t i = 0;
+        while (i < data.size()) {
+            size_t length = 0, distance = 0;
+            if (i + MIN_MATCH <= data.size()) {
+                uint32_t h = hash(i);
+                int64_t candidate = head[h];
+                head[h] = static_cast<int64_t>(i);
+                if (candidate >= 0 && i - candidate <= WINDOW_SIZE) {
+                    size_t limit = std::min(MAX_MATCH, data.size() - i);
+                    while (length < limit && data[candidate + length] == data[i + length]) length++;
+                    distance = i - candidate;
+                }
+            }
+
+            if (length >= MIN_MATCH) {
+                putMatch(bits, length, distance);
+                // index the covered positions sparsely, runs are found again from their start
+                for (size_t j = i + 1; j < i + length && j + MIN_MATCH <= data.size(); j += 16) {
+                    head[hash(j)] = static_cast<int64_t>(j);
+                }
+                i += length;
+            }
+            else {
+                putLiteral(bits, data[i]);
+                i++;
+            }
+        }
+        putLiteral(bits, 256);
+        bits.flush();
+        return out;
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+            }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    uint32_t adler32(const std::vector<uint8_t>& data) {
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : data) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+        putBigEndian(out, static_cast<uint32_t>(data.size()));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putBigEndian(out, crc32(out.data() + start, out.size() - start));
+    }
+
+    void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.good()) {
+            throw std::runtime_error("Cannot open file for writing: " + path);
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file.good()) {
+            throw std::runtime_error("Failed writing file: " + path);
+        }
+    }
+}
+
+namespace image {
+
+    void savePng(const std::string& path, const uint8_t* pixels, int width, int height, int pitch) {
+        tracing::Span span("savePng");
+
+        // every scanline starts with filter type 0, the remaining bytes are RGB
+        std::vector<uint8_t> raw;
+        raw.reserve(static_cast<size_t>(height) * (width * 3 + 1));
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = pixels + static_cast<size_t>(y) * pitch;
+            raw.push_back(0);
+            for (int x = 0; x < width; x++) {
+                raw.insert(raw.end(), row + x * 4, row + x * 4 + 3);
+            }
+        }
+
+        std::vector<uint8_t> compressed = { 0x78, 0x01 };
+        std::vector<uint8_t> body = deflate(raw);
+        compressed.insert(compressed.end(), body.begin(), body.end());
+        putBigEndian(compressed, adler32(raw));
+
+        std::vector<uint8_t> header;
+        putBigEndian(header, static_cast<uint32_t>(width));
+        putBigEndian(header, static_cast<uint32_t>(height));
+        header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, no interlace
+
+        std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        putChunk(png, "IHDR", header);
+        putChunk(png, "IDAT", compressed);
+        putChunk(png, "IEND", {});
+        writeFile(path, png);
+    }
+
+    void savePpm(const std::string& path, const uint8_t* pixels, int width, int height, int pitch) {
+        tracing::Span span("savePpm");
+
+        std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        std::vector<uint8_t> ppm(header.begin(), header.end());
+        ppm.reserve(ppm.size() + static_cast<size_t>(width) * height * 3);
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = pixels + static_cast<size_t>(y) * pitch;
+            for (int x = 0; x < width; x++) {
+                ppm.insert(ppm.end(), row + x * 4, row + x * 4 + 3);
+            }
+        }
+        writeFile(path, ppm);
+    }
+
+    void save(const std::string& path, const uint8_t* pixels, int width, int height, int pitch) {
+        std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".ppm") {
+            savePpm(path, pixels, width, height, pitch);
+        }
+        else {
+            savePng(path, pixels, width, height, pitch);
+        }
+    }
+
+}
@@ -5,16 +5,29 @@
 #include "cli.hpp"
 #include "fileHandler.hpp"
 #include "getZeroes.hpp"
+#include "profiler.hpp"
+#include "tracing.hpp"
+#include "allocationCounter.hpp"
+#include "textRenderer.hpp"
+#include "textCache.hpp"
+#include "backgroundLayer.hpp"
+#include "headless.hpp"
+#include "computeWorker.hpp"
+#include "tasks.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <map>
 #include <fmt/core.h>
 
 
-#define MESSAGE "Calc\nm: toggle help\n\n<arrows>: navigate\n+/-: zoom\nr: reset view\n\n1-6: toggle function definition\n<shift>1-6: edit function definiton\n<esc>: exit edit mode\na: show all functions\n\n<shift>s: save\n<ctrl><shift>s: export roots\n\n<shift><esc>: exit"
+#define MESSAGE "Calc\nm: toggle help\np: toggle profiler\ne: toggle envelope plotting\nt: write trace\n\n<arrows>: navigate\n+/-: zoom\nr: reset view\n\n1-9: toggle function definition\n<shift>1-9: edit function definiton\nn: new function, name = expression\n<esc>: exit edit mode\na: show all functions\n\n<shift>s: save\n<ctrl><shift>s: export roots\n\n<shift><esc>: exit"
 
 #ifdef __WIN32__
 #define ENTRYPOINT int WinMain()
@@ -31,6 +44,42 @@ ENTRYPOINT{
     const int SCREEN_HEIGHT = cli.height();
     const std::string FONT_PATH = cli.fontFilePath();
     const std::optional<std::string> LOAD_PATH = cli.loadPath();
+    const std::optional<std::string> TRACE_PATH = cli.tracePath();
+    const int SAMPLE_CACHE_MB = std::max(1, cli.sampleCacheMegabytes());
+    const float LINE_WIDTH = cli.lineWidth();
+
+    if (TRACE_PATH.has_value()) {
+        tracing::start(TRACE_PATH.value());
+    }
+
+    // root finding, curve sampling and exports all share this one pool
+    tasks::start(cli.threads());
+
+    if (cli.headless()) {
+        int status = 1;
+        try {
+            std::optional<std::string> batchPath = cli.batchPath();
+            std::vector<headless::Job> jobs = batchPath.has_value()
+                ? headless::loadJobs(batchPath.value(), LOAD_PATH)
+                : headless::jobsFromArguments(cli.outPaths(), cli.views(), LOAD_PATH);
+            if (jobs.empty()) {
+                std::cerr << "Error: headless mode needs --out or --batch" << std::endl;
+            }
+            else {
+                tasks::Cancellation cancellation;
+                if (cli.timeLimit() > 0.0) {
+                    cancellation.deadline = std::chrono::steady_clock::now()
+                        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(cli.timeLimit()));
+                }
+                status = headless::run(jobs, SCREEN_WIDTH, SCREEN_HEIGHT, FONT_PATH, LINE_WIDTH, cancellation);
+            }
+        }
+        catch (std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << std::endl;
+        }
+        tracing::stop();
+        return status;
+    }
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
@@ -60,21 +109,18 @@ ENTRYPOINT{
         return 1;
     }
 
-    TTF_Font* font = TTF_OpenFont(FONT_PATH.c_str(), 20);
-    if (!font) {
+    const int FONT_SIZE = 20;
+    TextRenderer text(renderer, FONT_PATH);
+    if (!text.ready(FONT_SIZE)) {
         std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
     }
+    TextCache textCache(renderer, text);
+    BackgroundLayer background(renderer, text);
 
     bool showMenu = true;
-    functionMapping fs = {
-        {"sin", [](ld x) {return std::sin(x); }},
-        {"cos", [](ld x) {return std::cos(x); }},
-        {"log", [](ld x) {return std::log(x); }},
-        {"exp", [](ld x) {return std::exp(x); }},
-        {"logtwo", [](ld x) {return std::log2(x); }},
-        {"tan", [](ld x) {return std::tan(x); }},
-        {"pi", [](ld x) {return M_PI * x; }}
-    };
+    bool showProfiler = false;
+    bool envelopeMode = false;
+    functionMapping fs = standardFunctions();
 
     try {
         double minX = -10.0;
@@ -82,26 +128,17 @@ ENTRYPOINT{
         double minY = -5.0;
         double maxY = 5.0;
         bool editing = false;
-        char toDisplay = '\0';
+        std::optional<FunctionId> toDisplay;
         bool showAllFunctions = false;
-        char editingFunctionId = '\0';
+        std::string editingName; // an input with "name =" in front defines that name instead
         std::string currentInput = "";
         std::string errorMessage = "";
         bool showError = false;
-        int errorDisplayTime = 0;
+        Uint64 errorHideAt = 0;
         std::string statusMessage = "";
-        int statusDisplayTime = 0;
+        Uint64 statusHideAt = 0;
 
 
-        std::array<SDL_Color, 6> functionColors = {
-            SDL_Color{255, 0, 0, 255},
-            SDL_Color{0, 255, 0, 255},
-            SDL_Color{0, 128, 255, 255},
-            SDL_Color{255, 255, 0, 255},
-            SDL_Color{255, 0, 255, 255},
-            SDL_Color{0, 255, 255, 255}
-        };
-
         std::cout << "cam";
 
         FunctionFactory fns = [&]() {
@@ -114,13 +151,122 @@ ENTRYPOINT{
             }
             }();
 
+        // indexed by FunctionId, empty where nothing is defined
+        std::vector<std::string> expressionLabels;
+        auto refreshExpressions = [&]() {
+            std::shared_ptr<const FunctionSnapshot> registry = fns.snapshot();
+            expressionLabels.assign(registry->size(), std::string());
+            for (FunctionId id = 0; id < registry->size(); id++) {
+                if (registry->functions[id]) {
+                    expressionLabels[id] = fmt::format("{}(x) = {}", registry->names[id], registry->functions[id]->expression);
+                }
+            }
+            };
+        refreshExpressions();
+
+        // new definitions take the first free one letter name unless the input names them
+        auto freeName = [&]() {
+            std::shared_ptr<const FunctionSnapshot> registry = fns.snapshot();
+            for (char c = 'a'; c <= 'z'; c++) {
+                if (c != 'x' && !registry->find(std::string(1, c)).has_value()) return std::string(1, c);
+            }
+            size_t n = registry->size();
+            while (registry->find(fmt::format("f{}", n)).has_value()) n++;
+            return fmt::format("f{}", n);
+            };
+        auto startEditing = [&](const std::string& name, const std::string& expression) {
+            if (editingName != name) {
+                showError = false;
+                errorMessage = "";
+            }
+            editing = true;
+            editingName = name;
+            currentInput = expression;
+            SDL_StartTextInput();
+            };
+
+        // Curves are sampled progressively on the compute worker: a view change gets the coarse grid
+        // right away and later rounds refine it, restarting whenever the view or a definition
+        // changes again. Every published result wakes the loop with a user event.
+        const Uint32 CURVES_READY = SDL_RegisterEvents(1);
+        ComputeWorker worker(static_cast<size_t>(SAMPLE_CACHE_MB) << 20, [CURVES_READY]() {
+            SDL_Event ready = {};
+            ready.type = CURVES_READY;
+            SDL_PushEvent(&ready);
+            });
+        ComputeWorker::View submittedView;
+        std::vector<std::pair<FunctionId, uint64_t>> submittedFunctions;
+        bool submitPending = false;
+        std::vector<SDL_FPoint> reprojected;
+
         bool quit = false;
         SDL_Event e;
 
-        char lastEditingFunctionId = '\0';
+        std::vector<std::string> menuLines;
+        {
+            std::istringstream stream(MESSAGE);
+            std::string line;
+            while (std::getline(stream, line, '\n')) {
+                menuLines.push_back(line);
+            }
+        }
+
+        profiler::Stage& backgroundStage = profiler::stage("background");
+        profiler::Stage& plotStage = profiler::stage("plot");
+        profiler::Stage& overlayStage = profiler::stage("overlay");
+        profiler::Stage& presentStage = profiler::stage("present");
+
+        // frames are only rendered when something visible changed, otherwise the loop sleeps in
+        // SDL_WaitEventTimeout until the next event or timed overlay deadline
+        const Uint64 FRAME_INTERVAL = 16;
+        const Uint64 HUD_REFRESH_INTERVAL = 250;
+        const auto ROOTS_TIME_LIMIT = std::chrono::seconds(5);
+        bool dirty = true;
+        Uint64 lastRender = 0;
 
         while (!quit) {
+            Uint64 now = SDL_GetTicks64();
+            Uint64 wakeAt = std::numeric_limits<Uint64>::max();
+            if (dirty) wakeAt = lastRender + FRAME_INTERVAL;
+            if (statusHideAt) wakeAt = std::min(wakeAt, statusHideAt);
+            if (showError && errorHideAt) wakeAt = std::min(wakeAt, errorHideAt);
+            if (showProfiler) wakeAt = std::min(wakeAt, lastRender + HUD_REFRESH_INTERVAL);
+
+            if (wakeAt > now) {
+                int timeout = wakeAt == std::numeric_limits<Uint64>::max() ? -1 : static_cast<int>(wakeAt - now);
+                SDL_WaitEventTimeout(NULL, timeout);
+                now = SDL_GetTicks64();
+            }
+
+            if (statusHideAt && now >= statusHideAt) {
+                statusHideAt = 0;
+                dirty = true;
+            }
+            if (showError && errorHideAt && now >= errorHideAt) {
+                showError = false;
+                errorHideAt = 0;
+                dirty = true;
+            }
+            if (showProfiler && now >= lastRender + HUD_REFRESH_INTERVAL) {
+                dirty = true;
+            }
+
             while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_KEYDOWN || e.type == SDL_TEXTINPUT || e.type == SDL_WINDOWEVENT) {
+                    dirty = true;
+                }
+
+                // render target textures lose their contents, cached labels have to be drawn again
+                if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+                    background.invalidate();
+                    textCache.release();
+                    dirty = true;
+                }
+
+                if (e.type == CURVES_READY) {
+                    dirty = true;
+                }
+
                 if (e.type == SDL_QUIT) {
                     quit = true;
                 }
@@ -129,7 +275,7 @@ ENTRYPOINT{
                     if (e.key.keysym.sym == SDLK_ESCAPE) {
                         editing = false;
 
-                        editingFunctionId = '\0';
+                        editingName.clear();
                         currentInput = "";
                         SDL_StopTextInput();
 
@@ -141,11 +287,17 @@ ENTRYPOINT{
                         if (!currentInput.empty()) {
                             try {
 
-                                fns.parseFunction(currentInput, editingFunctionId);
+                                auto [name, expression] = currentInput.find('=') != std::string::npos
+                                    ? splitDefinition(currentInput) : std::make_pair(editingName, currentInput);
+                                FunctionId id = fns.parseFunction(expression, name);
+                                refreshExpressions();
+                                if (!showAllFunctions) {
+                                    toDisplay = id;
+                                }
 
 
                                 editing = false;
-                                editingFunctionId = '\0';
+                                editingName.clear();
                                 currentInput = "";
                                 SDL_StopTextInput();
 
@@ -155,9 +307,9 @@ ENTRYPOINT{
                             }
                             catch (const std::exception& ex) {
 
-                                errorMessage = ex.what();
+                                errorMessage = fmt::format("Error: {}", ex.what());
                                 showError = true;
-                                errorDisplayTime = 120;
+                                errorHideAt = SDL_GetTicks64() + 2000;
                                 currentInput = "";
 
                             }
@@ -186,6 +338,21 @@ ENTRYPOINT{
                     case SDLK_m:
                         showMenu = !showMenu;
                         break;
+                    case SDLK_e:
+                        envelopeMode = !envelopeMode;
+                        break;
+                    case SDLK_p:
+                        showProfiler = !showProfiler;
+                        break;
+                    case SDLK_t:
+                        if (tracing::flush()) {
+                            statusMessage = "Trace written to " + TRACE_PATH.value();
+                        }
+                        else {
+                            statusMessage = "Tracing is off, start with --trace <path>";
+                        }
+                        statusHideAt = SDL_GetTicks64() + 2000;
+                        break;
                     case SDLK_UP:
                         minY += rangeY * 0.05;
                         maxY += rangeY * 0.05;
@@ -234,24 +401,35 @@ ENTRYPOINT{
 
                         showAllFunctions = !showAllFunctions;
                         if (showAllFunctions) {
-                            toDisplay = '\0';
+                            toDisplay.reset();
                         }
                         break;
+                    case SDLK_n:
+                        showAllFunctions = false;
+                        startEditing(freeName(), "");
+                        break;
                     case SDLK_s:
                         if ((e.key.keysym.mod & KMOD_CTRL) && (e.key.keysym.mod & KMOD_SHIFT)) {
                             try {
                                 std::vector<std::string> all_roots_formatted_lines;
-                                const functionMapping& current_functions = fns.getFunctions();
+                                std::shared_ptr<const FunctionSnapshot> current_functions = fns.snapshot();
                                 bool functions_found_for_export = false;
 
-                                for (const auto& pair : current_functions) {
-                                    if (pair.first.length() == 1 && pair.first[0] >= 'a' && pair.first[0] <= 'f') {
+                                // the window is unresponsive meanwhile, so the whole search gets a deadline
+                                tasks::Cancellation search;
+                                search.deadline = std::chrono::steady_clock::now() + ROOTS_TIME_LIMIT;
+                                tasks::Status searchStatus = tasks::Status::Complete;
+                                std::vector<ld> roots;
+
+                                for (FunctionId id = 0; id < current_functions->size(); id++) {
+                                    if (current_functions->functions[id]) {
                                         functions_found_for_export = true;
-                                        char functionIdChar = pair.first[0];
-                                        const auto& func_to_eval = pair.second;
-                                        std::vector<ld> roots = getZeroes(func_to_eval);
+                                        const std::string& functionName = current_functions->names[id];
+                                        const auto& func_to_eval = current_functions->functions[id]->fn;
+                                        tasks::Status status = getZeroes(func_to_eval, roots, search);
+                                        if (status != tasks::Status::Complete) searchStatus = status;
 
-                                        all_roots_formatted_lines.push_back(std::string(1, functionIdChar) + ":");
+                                        all_roots_formatted_lines.push_back(functionName + ":");
                                         for (ld root_val : roots) {
                                             all_roots_formatted_lines.push_back(fmt::format("{}", root_val));
                                         }
@@ -261,17 +439,20 @@ ENTRYPOINT{
                                 if (functions_found_for_export) {
                                     fileHandler::saveFile(all_roots_formatted_lines, "roots.txt");
                                     statusMessage = "Roots exported to roots.txt";
+                                    if (searchStatus != tasks::Status::Complete) {
+                                        statusMessage += fmt::format(" (search {}, partial)", tasks::describe(searchStatus));
+                                    }
                                 }
                                 else {
-                                    statusMessage = "No functions (a-f) to export roots for.";
+                                    statusMessage = "No functions to export roots for.";
                                 }
-                                statusDisplayTime = 120;
+                                statusHideAt = SDL_GetTicks64() + 2000;
 
                             }
                             catch (const std::exception& ex) {
                                     statusMessage = "Error exporting roots: ";
                                     statusMessage += ex.what();
-                                    statusDisplayTime = 180;
+                                    statusHideAt = SDL_GetTicks64() + 3000;
                             }
 }
                         else if (e.key.keysym.mod & KMOD_SHIFT) {
@@ -280,12 +461,12 @@ ENTRYPOINT{
                                 std::string savePath = "functions.txt";
                                 fileHandler::saveFile(functionsToSave, savePath);
                                 statusMessage = "Functions saved to " + savePath;
-                                statusDisplayTime = 120;
+                                statusHideAt = SDL_GetTicks64() + 2000;
                             }
                             catch (const std::exception& ex) { 
                                 statusMessage = "Error saving functions: ";
                                 statusMessage += ex.what();
-                                statusDisplayTime = 180;
+                                statusHideAt = SDL_GetTicks64() + 3000;
                             }
                         }
                         break;
@@ -299,47 +480,28 @@ ENTRYPOINT{
                     case SDLK_4:
                     case SDLK_5:
                     case SDLK_6:
+                    case SDLK_7:
+                    case SDLK_8:
+                    case SDLK_9:
                     {
+                        // the keys reach the first nine IDs, later ones are shown with 'a' and edited by name
                         showAllFunctions = false;
-                        char functionId = 'a' + (e.key.keysym.sym - SDLK_1);
-                        std::string fnKey(1, functionId);
+                        FunctionId functionId = static_cast<FunctionId>(e.key.keysym.sym - SDLK_1);
+                        std::shared_ptr<const FunctionSnapshot> registry = fns.snapshot();
+                        bool defined = functionId < registry->size() && registry->functions[functionId];
 
                         if (e.key.keysym.mod & KMOD_SHIFT) {
-                            editing = true;
-
-                            if (editingFunctionId != functionId) {
-                                showError = false;
-                                errorMessage = "";
-                            }
-
-                            editingFunctionId = functionId;
-
-                            if (!showAllFunctions) {
+                            if (defined) {
                                 toDisplay = functionId;
+                                startEditing(registry->names[functionId], registry->functions[functionId]->expression);
                             }
-
-
-                            std::vector<std::string> expressions = fns.exportFunctions();
-                            currentInput = "";
-
-
-                            for (const auto& expr : expressions) {
-                                if (!expr.empty() && expr[0] == functionId) {
-
-                                    currentInput = expr.substr(1);
-                                    break;
-                                }
+                            else {
+                                startEditing(freeName(), "");
                             }
-
-
-                            SDL_StartTextInput();
                         }
-                        else if (!showAllFunctions) {
-
-                            showAllFunctions = false;
-
+                        else if (defined) {
                             if (toDisplay == functionId) {
-                                toDisplay = '\0';
+                                toDisplay.reset();
                             }
                             else {
                                 toDisplay = functionId;
@@ -363,250 +525,217 @@ ENTRYPOINT{
                 }
             }
 
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-
-            graph::drawGrid(renderer, minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT);
-            graph::drawAxes(renderer, minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT, FONT_PATH.c_str());
-
-
-            const functionMapping& functions = fns.getFunctions();
+            if (quit || !dirty || now < lastRender + FRAME_INTERVAL) {
+                continue;
+            }
+            dirty = false;
+            lastRender = now;
 
-            if (toDisplay == '\0') {
+            {
+                profiler::ScopedTimer timer(backgroundStage);
+                background.draw(minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT);
+            }
 
-                for (const auto& pair : functions) {
-                    if (pair.first.size() == 1) {
-                        char functionId = pair.first[0];
-                        if (functionId >= 'a' && functionId <= 'f') {
-                            int colorIndex = functionId - 'a';
 
-                            auto fn = pair.second;
-                            graph::plotFunction(renderer, fn, minX, maxX, minY, maxY,
-                                SCREEN_WIDTH, SCREEN_HEIGHT, functionColors[colorIndex]);
-                        }
+            // held for the whole frame, an edit meanwhile publishes a new snapshot instead
+            std::shared_ptr<const FunctionSnapshot> registry = fns.snapshot();
+            const compiledTable& functions = registry->functions;
+
+            struct Visible {
+                FunctionId id;
+                std::shared_ptr<const CompiledFunction> fn;
+                SDL_Color color;
+            };
+            std::vector<Visible> visible;
+            const ComputeWorker::Result& curves = worker.acquire();
+            if (!toDisplay.has_value()) {
+                for (FunctionId id = 0; id < functions.size(); id++) {
+                    if (functions[id]) {
+                        visible.push_back({ id, functions[id], graph::functionColor(id) });
                     }
                 }
             }
-            else {
-
-                std::string fnKey(1, toDisplay);
-                auto it = functions.find(fnKey);
-                if (it != functions.end()) {
-                    int colorIndex = toDisplay - 'a';
-                    auto fn = it->second;
-                    graph::plotFunction(renderer, fn, minX, maxX, minY, maxY,
-                        SCREEN_WIDTH, SCREEN_HEIGHT, functionColors[colorIndex]);
-                }
+            else if (toDisplay.value() < functions.size() && functions[toDisplay.value()]) {
+                visible.push_back({ toDisplay.value(), functions[toDisplay.value()], graph::functionColor(toDisplay.value()) });
             }
 
-            if (showMenu && font) {
-                std::vector<std::string> menuLines;
-                std::istringstream stream(MESSAGE);
-                std::string line;
+            {
+                profiler::ScopedTimer timer(plotStage);
 
-                while (std::getline(stream, line, '\n')) {
-                    menuLines.push_back(line);
+                // snapshots are only sent when the view or a visible definition changed
+                const ComputeWorker::View view = { minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT };
+                if (!envelopeMode) {
+                    std::vector<std::pair<FunctionId, uint64_t>> shown;
+                    for (const Visible& v : visible) {
+                        shown.emplace_back(v.id, registry->revision(v.id));
+                    }
+                    if (submitPending || view != submittedView || shown != submittedFunctions) {
+                        std::vector<ComputeWorker::Snapshot> snapshots;
+                        for (const Visible& v : visible) {
+                            snapshots.push_back({ v.id, v.fn, registry->revision(v.id) });
+                        }
+                        submitPending = !worker.submit(view, std::move(snapshots));
+                        submittedView = view;
+                        submittedFunctions = std::move(shown);
+                    }
                 }
 
-                int lineHeight = TTF_FontHeight(font);
-                int menuHeight = lineHeight * menuLines.size() + 30;
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
-                SDL_Rect menuBackground = { 20, 20, SCREEN_WIDTH - 40, menuHeight };
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_RenderFillRect(renderer, &menuBackground);
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
-
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                SDL_RenderDrawRect(renderer, &menuBackground);
-
-                SDL_Color textColor = { 255, 255, 255, 255 };
-                for (size_t i = 0; i < menuLines.size(); i++) {
-                    SDL_Surface* textSurface = TTF_RenderText_Blended(font, menuLines[i].c_str(), textColor);
-                    if (textSurface) {
-                        SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-                        if (textTexture) {
-                            SDL_Rect textRect = {
-                                30,
-                                35 + static_cast<int>(i) * lineHeight,
-                                textSurface->w,
-                                textSurface->h
-                            };
-                            SDL_RenderCopy(renderer, textTexture, NULL, &textRect);
-                            SDL_DestroyTexture(textTexture);
-                        }
-                        SDL_FreeSurface(textSurface);
+                // drawn in definition order so overlapping curves stack the same way every frame,
+                // results of an older view are moved into place until the current one arrives.
+                // Both lists are in ID order, so the matching polyline is found by bisection.
+                for (const Visible& v : visible) {
+                    if (envelopeMode) {
+                        graph::plotEnvelope(renderer, v.fn->fn, minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT, v.color);
+                        continue;
                     }
+                    auto line = std::lower_bound(curves.curves.begin(), curves.curves.end(), v.id,
+                        [](const ComputeWorker::Polyline& l, FunctionId id) { return l.id < id; });
+                    if (line == curves.curves.end() || line->id != v.id) continue;
+
+                    const ComputeWorker::View& from = curves.view;
+                    const SDL_FPoint* points = line->points.data();
+                    if (from != view) {
+                        reprojected.resize(line->points.size());
+                        graph::reproject(line->points.data(), line->points.size(),
+                            from.minX, from.maxX, from.minY, from.maxY, from.screenWidth, from.screenHeight,
+                            minX, maxX, minY, maxY, SCREEN_WIDTH, SCREEN_HEIGHT, reprojected.data());
+                        points = reprojected.data();
+                    }
+                    graph::drawCurve(renderer, points, line->ys.data(), line->points.size(),
+                        minY, maxY, v.color, LINE_WIDTH);
                 }
             }
 
+            {
+                profiler::ScopedTimer timer(overlayStage);
+                if (showMenu && text.ready(FONT_SIZE)) {
+                    int lineHeight = text.lineHeight(FONT_SIZE);
+                    int menuHeight = lineHeight * menuLines.size() + 30;
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+                    SDL_Rect menuBackground = { 20, 20, SCREEN_WIDTH - 40, menuHeight };
+                    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+                    SDL_RenderFillRect(renderer, &menuBackground);
+                    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
 
-            if (font) {
-
-                std::vector<std::string> expressions = fns.exportFunctions();
-
-                if (showAllFunctions) {
-
-                    int yPos = SCREEN_HEIGHT - 10;
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    SDL_RenderDrawRect(renderer, &menuBackground);
 
+                    SDL_Color textColor = { 255, 255, 255, 255 };
+                    for (size_t i = 0; i < menuLines.size(); i++) {
+                        textCache.draw(menuLines[i], 30, 35 + static_cast<int>(i) * lineHeight, FONT_SIZE, textColor);
+                    }
+                }
 
 
+                if (text.ready(FONT_SIZE)) {
 
-                    for (auto it = expressions.rbegin(); it != expressions.rend(); ++it) {
-                        const auto& expr = *it;
-                        if (!expr.empty() && expr[0] >= 'a' && expr[0] <= 'f') {
-                            char functionId = expr[0];
+                    int lineHeight = text.lineHeight(FONT_SIZE);
 
+                    if (showAllFunctions) {
 
-                            std::string fnKey(1, functionId);
-                            if (functions.find(fnKey) != functions.end()) {
-                                int colorIndex = functionId - 'a';
-                                SDL_Color textColor = functionColors[colorIndex];
+                        int yPos = SCREEN_HEIGHT - 10;
 
-                                std::string displayText = fmt::format("{}(x) = {}", functionId, expr.substr(1));
-                                SDL_Surface* exprSurface = TTF_RenderText_Blended(font, displayText.c_str(), textColor);
-                                if (exprSurface) {
-                                    SDL_Texture* exprTexture = SDL_CreateTextureFromSurface(renderer, exprSurface);
-                                    if (exprTexture) {
-                                        SDL_Rect exprRect = {
-                                            10,
-                                            yPos - exprSurface->h,
-                                            exprSurface->w,
-                                            exprSurface->h
-                                        };
-                                        SDL_RenderCopy(renderer, exprTexture, NULL, &exprRect);
-                                        SDL_DestroyTexture(exprTexture);
-                                    }
-                                    yPos -= exprSurface->h + 5;
-                                    SDL_FreeSurface(exprSurface);
-                                }
+                        // the newest definitions at the bottom, as many as fit
+                        for (FunctionId id = static_cast<FunctionId>(expressionLabels.size()); id-- > 0 && yPos - lineHeight >= 0;) {
+                            if (!expressionLabels[id].empty()) {
+                                textCache.draw(expressionLabels[id], 10, yPos - lineHeight, FONT_SIZE, graph::functionColor(id));
+                                yPos -= lineHeight + 5;
                             }
                         }
                     }
-                }
-                else {
+                    else {
 
-                    SDL_Color textColor = { 255, 255, 255, 255 };
-                    std::string displayText;
+                        SDL_Color textColor = { 255, 255, 255, 255 };
+                        std::string_view displayText;
+                        std::string editText;
 
-                    if (editing) {
+                        if (editing) {
 
-                        int colorIndex = editingFunctionId - 'a';
-                        textColor = functionColors[colorIndex];
-                        displayText = fmt::format("{}(x) = {} _", editingFunctionId, currentInput);
-                    }
-                    else if (toDisplay != '\0') {
-
-                        std::string fnKey(1, toDisplay);
-                        if (functions.find(fnKey) != functions.end()) {
-                            int colorIndex = toDisplay - 'a';
-                            textColor = functionColors[colorIndex];
-
-
-                            std::string expressionText;
-                            for (const auto& expr : expressions) {
-                                if (!expr.empty() && expr[0] == toDisplay) {
-                                    expressionText = expr;
-                                    break;
-                                }
+                            // a new name is drawn in the color of the ID it will get
+                            textColor = graph::functionColor(registry->find(editingName).value_or(static_cast<FunctionId>(registry->size())));
+                            if (currentInput.find('=') != std::string::npos) {
+                                editText = fmt::format("{} _", currentInput);
                             }
-
-                            if (!expressionText.empty()) {
-                                displayText = fmt::format("{}(x) = {}", expressionText[0], expressionText.substr(1));
+                            else {
+                                editText = fmt::format("{}(x) = {} _", editingName, currentInput);
                             }
+                            displayText = editText;
+                        }
+                        else if (toDisplay.has_value() && toDisplay.value() < expressionLabels.size()) {
+                            textColor = graph::functionColor(toDisplay.value());
+                            displayText = expressionLabels[toDisplay.value()];
                         }
-                    }
 
-                    if (!displayText.empty()) {
-                        SDL_Surface* exprSurface = TTF_RenderText_Blended(font, displayText.c_str(), textColor);
-                        if (exprSurface) {
-                            SDL_Texture* exprTexture = SDL_CreateTextureFromSurface(renderer, exprSurface);
-                            if (exprTexture) {
-                                SDL_Rect exprRect = {
-                                    10,
-                                    SCREEN_HEIGHT - exprSurface->h - 10,
-                                    exprSurface->w,
-                                    exprSurface->h
-                                };
-                                SDL_RenderCopy(renderer, exprTexture, NULL, &exprRect);
-                                SDL_DestroyTexture(exprTexture);
-                            }
-                            SDL_FreeSurface(exprSurface);
+                        if (!displayText.empty()) {
+                            textCache.draw(displayText, 10, SCREEN_HEIGHT - lineHeight - 10, FONT_SIZE, textColor);
                         }
                     }
-                }
 
-                if (statusDisplayTime > 0) {
-                    SDL_Color statusColor = { 100, 255, 100, 255 };
-                    SDL_Surface* statusSurface = TTF_RenderText_Blended(font, statusMessage.c_str(), statusColor);
-                    if (statusSurface) {
-                        SDL_Texture* statusTexture = SDL_CreateTextureFromSurface(renderer, statusSurface);
-                        if (statusTexture) {
-                            SDL_Rect statusRect = {
-                                (SCREEN_WIDTH - statusSurface->w) / 2,
-                                20,
-                                statusSurface->w,
-                                statusSurface->h
-                            };
-                            SDL_RenderCopy(renderer, statusTexture, NULL, &statusRect);
-                            SDL_DestroyTexture(statusTexture);
-                        }
-                        SDL_FreeSurface(statusSurface);
+                    if (statusHideAt) {
+                        SDL_Color statusColor = { 100, 255, 100, 255 };
+                        textCache.draw(statusMessage, (SCREEN_WIDTH - text.measure(statusMessage, FONT_SIZE)) / 2, 20, FONT_SIZE, statusColor);
                     }
 
-                    statusDisplayTime--;
+                    if (editing) {
+                        SDL_SetRenderDrawColor(renderer, 30, 30, 30, 200);
+                        SDL_Rect editBox = {
+                            0,
+                            SCREEN_HEIGHT - 40,
+                            SCREEN_WIDTH,
+                            40
+                        };
+                        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+                        SDL_RenderFillRect(renderer, &editBox);
+                        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+                        SDL_SetRenderDrawColor(renderer, 100, 100, 255, 255);
+                        SDL_RenderDrawRect(renderer, &editBox);
+
+
+                        if (showError && !errorMessage.empty()) {
+                            SDL_Color errorColor = { 255, 100, 100, 255 };
+                            textCache.draw(errorMessage, 10, SCREEN_HEIGHT - 80, FONT_SIZE, errorColor);
+                        }
+                    }
                 }
 
-                if (editing) {
-                    SDL_SetRenderDrawColor(renderer, 30, 30, 30, 200);
-                    SDL_Rect editBox = {
-                        0,
-                        SCREEN_HEIGHT - 40,
-                        SCREEN_WIDTH,
-                        40
-                    };
+                if (showProfiler && text.ready(FONT_SIZE)) {
+                    std::vector<std::string> hudLines = profiler::report();
+                    std::vector<std::string> allocationLines = allocations::report();
+                    hudLines.insert(hudLines.end(), allocationLines.begin(), allocationLines.end());
+                    hudLines.push_back(fmt::format("text cache {} entries {} KB", textCache.size(), textCache.bytes() / 1024));
+                    hudLines.push_back(fmt::format("sample cache {} tiles {} KB", curves.cacheTiles, curves.cacheBytes / 1024));
+                    int lineHeight = text.lineHeight(FONT_SIZE);
+                    int hudWidth = 0;
+                    for (const auto& line : hudLines) {
+                        hudWidth = std::max(hudWidth, text.measure(line, FONT_SIZE));
+                    }
+
+                    SDL_Rect hudBackground = { SCREEN_WIDTH - hudWidth - 30, 10, hudWidth + 20, lineHeight * static_cast<int>(hudLines.size()) + 10 };
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
                     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                    SDL_RenderFillRect(renderer, &editBox);
+                    SDL_RenderFillRect(renderer, &hudBackground);
                     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
 
-                    SDL_SetRenderDrawColor(renderer, 100, 100, 255, 255);
-                    SDL_RenderDrawRect(renderer, &editBox);
-
-
-                    if (showError && !errorMessage.empty()) {
-                        SDL_Color errorColor = { 255, 100, 100, 255 };
-                        std::string errorText = fmt::format("Error: {}", errorMessage);
-                        SDL_Surface* errorSurface = TTF_RenderText_Blended(font, errorText.c_str(), errorColor);
-                        if (errorSurface) {
-                            SDL_Texture* errorTexture = SDL_CreateTextureFromSurface(renderer, errorSurface);
-                            if (errorTexture) {
-                                SDL_Rect errorRect = {
-                                    10,
-                                    SCREEN_HEIGHT - 80,
-                                    errorSurface->w,
-                                    errorSurface->h
-                                };
-                                SDL_RenderCopy(renderer, errorTexture, NULL, &errorRect);
-                                SDL_DestroyTexture(errorTexture);
-                            }
-                            SDL_FreeSurface(errorSurface);
-                        }
-
-
-                        if (errorDisplayTime > 0) {
-                            errorDisplayTime--;
-                            if (errorDisplayTime == 0) {
-                                showError = false;
-                            }
-                        }
+                    SDL_Color hudColor = { 255, 200, 0, 255 };
+                    for (size_t i = 0; i < hudLines.size(); i++) {
+                        text.draw(hudLines[i], hudBackground.x + 10, hudBackground.y + 5 + static_cast<int>(i) * lineHeight, FONT_SIZE, hudColor);
                     }
+                    text.flush();
                 }
             }
 
-            SDL_RenderPresent(renderer);
-            SDL_Delay(16);
+            {
+                profiler::ScopedTimer timer(presentStage);
+                SDL_RenderPresent(renderer);
+            }
+            profiler::endFrame();
+            allocations::endFrame();
+
+            // a submission that found the queue full is retried on the next frame
+            if (submitPending) dirty = true;
 
 
-            lastEditingFunctionId = editingFunctionId;
         }
 
 
@@ -624,9 +753,11 @@ ENTRYPOINT{
         }
     }
 
-    if (font) {
-        TTF_CloseFont(font);
-    }
+    tracing::stop();
+
+    background.release();
+    textCache.release();
+    text.release();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     TTF_Quit();
@@ -0,0 +1,109 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <fmt/core.h>
+
+namespace {
+    std::vector<std::unique_ptr<profiler::Stage>> stages;
+    profiler::Stage frameTimes("frame");
+    profiler::Stage evaluations("evals");
+    std::atomic<size_t> evaluationsThisFrame = 0;
+    profiler::clock::time_point lastFrame;
+    bool hasLastFrame = false;
+}
+
+namespace profiler {
+
+    Stage::Stage(const char* name) : name(name) {}
+
+    void Stage::add(double ms) {
+        pending += ms;
+    }
+
+    void Stage::commit() {
+        samples[cursor] = pending;
+        cursor = (cursor + 1) % WINDOW;
+        count = std::min(count + 1, WINDOW);
+        pending = 0.0;
+    }
+
+    const char* Stage::label() const {
+        return name;
+    }
+
+    double Stage::average() const {
+        if (count == 0) return 0.0;
+        double sum = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            sum += samples[i];
+        }
+        return sum / count;
+    }
+
+    double Stage::p99() const {
+        if (count == 0) return 0.0;
+        std::array<double, WINDOW> sorted = samples;
+        size_t idx = (count * 99 + 99) / 100 - 1;
+        std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.begin() + count);
+        return sorted[idx];
+    }
+
+    ScopedTimer::ScopedTimer(Stage& stage) : stage(stage), start(clock::now()), span(stage.label()) {}
+
+    ScopedTimer::ScopedTimer(const char* name) : ScopedTimer(profiler::stage(name)) {}
+
+    ScopedTimer::~ScopedTimer() {
+        stage.add(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+    }
+
+    Stage& stage(const char* name) {
+        for (auto& s : stages) {
+            if (std::strcmp(s->label(), name) == 0) return *s;
+        }
+        stages.push_back(std::make_unique<Stage>(name));
+        return *stages.back();
+    }
+
+    void countEvaluations(size_t n) {
+        evaluationsThisFrame.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void endFrame() {
+        for (auto& s : stages) {
+            s->commit();
+        }
+
+        evaluations.add(static_cast<double>(evaluationsThisFrame.exchange(0, std::memory_order_relaxed)));
+        evaluations.commit();
+
+        clock::time_point now = clock::now();
+        if (hasLastFrame) {
+            frameTimes.add(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+            frameTimes.commit();
+        }
+        lastFrame = now;
+        hasLastFrame = true;
+    }
+
+    double fps() {
+        double ms = frameTimes.average();
+        return ms > 0.0 ? 1000.0 / ms : 0.0;
+    }
+
+    double evaluationsPerFrame() {
+        return evaluations.average();
+    }
+
+    std::vector<std::string> report() {
+        std::vector<std::string> lines;
+        lines.push_back(fmt::format("FPS {:.1f}  evals/frame {:.0f}", fps(), evaluationsPerFrame()));
+        for (auto& s : stages) {
+            lines.push_back(fmt::format("{:<8} avg {:6.2f} ms  p99 {:6.2f} ms", s->label(), s->average(), s->p99()));
+        }
+        return lines;
+    }
+
+}
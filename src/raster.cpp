@@ -0,0 +1,289 @@
+#include "raster.hpp"
+#include "graphHandler.hpp"
+#include "sampler.hpp"
+#include "tasks.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+    const int SAMPLES_PER_COLUMN = 2;
+    const int MIN_STRIP_WIDTH = 64;
+}
+
+namespace raster {
+
+    Font::Font(const std::string& path, int size) {
+        font = TTF_OpenFont(path.c_str(), size);
+        if (!font) return;
+        height = TTF_FontHeight(font);
+
+        const SDL_Color white = { 255, 255, 255, 255 };
+        for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+            Glyph& g = glyphs[c - FIRST_GLYPH];
+            TTF_GlyphMetrics(font, c, nullptr, nullptr, nullptr, nullptr, &g.advance);
+            SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, c, white);
+            if (rendered) {
+                g.surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+                SDL_FreeSurface(rendered);
+            }
+        }
+    }
+
+    Font::~Font() {
+        for (Glyph& g : glyphs) {
+            if (g.surface) SDL_FreeSurface(g.surface);
+        }
+        if (font) TTF_CloseFont(font);
+    }
+
+    bool Font::ready() const {
+        return font != nullptr;
+    }
+
+    int Font::lineHeight() const {
+        return height;
+    }
+
+    int Font::measure(std::string_view text) const {
+        int width = 0;
+        for (char c : text) {
+            width += advance(c);
+        }
+        return width;
+    }
+
+    const SDL_Surface* Font::surface(char c) const {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+        return glyphs[c - FIRST_GLYPH].surface;
+    }
+
+    int Font::advance(char c) const {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+        return glyphs[c - FIRST_GLYPH].advance;
+    }
+
+    Strip::Strip(uint8_t* pixels, int pitch, int left, int right, int height)
+        : pixels(pixels), pitch(pitch), left(left), right(right), height(height),
+        coveredLeft(right), coveredRight(left), coveredTop(height), coveredBottom(0) {}
+
+    int Strip::begin() const {
+        return left;
+    }
+
+    int Strip::end() const {
+        return right;
+    }
+
+    void Strip::put(int x, int y, SDL_Color c) {
+        if (x < left || x >= right || y < 0 || y >= height) return;
+        uint8_t* p = pixels + static_cast<size_t>(y) * pitch + static_cast<size_t>(x) * 4;
+        p[0] = c.r;
+        p[1] = c.g;
+        p[2] = c.b;
+        p[3] = 255;
+    }
+
+    void Strip::blend(int x, int y, SDL_Color c, int alpha) {
+        if (x < left || x >= right || y < 0 || y >= height || alpha == 0) return;
+        uint8_t* p = pixels + static_cast<size_t>(y) * pitch + static_cast<size_t>(x) * 4;
+        p[0] = static_cast<uint8_t>((c.r * alpha + p[0] * (255 - alpha) + 127) / 255);
+        p[1] = static_cast<uint8_t>((c.g * alpha + p[1] * (255 - alpha) + 127) / 255);
+        p[2] = static_cast<uint8_t>((c.b * alpha + p[2] * (255 - alpha) + 127) / 255);
+    }
+
+    void Strip::clear(SDL_Color c) {
+        for (int y = 0; y < height; y++) {
+            for (int x = left; x < right; x++) {
+                put(x, y, c);
+            }
+        }
+    }
+
+    void Strip::drawLine(int x0, int y0, int x1, int y1, SDL_Color c) {
+        if (y0 == y1) {
+            for (int x = std::max(std::min(x0, x1), left); x <= std::min(std::max(x0, x1), right - 1); x++) {
+                put(x, y0, c);
+            }
+            return;
+        }
+        if (std::max(x0, x1) < left || std::min(x0, x1) >= right) return;
+
+        // Bresenham from the first endpoint, so the pixels do not depend on the strip
+        int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+        int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+        int error = dx + dy;
+        while (true) {
+            put(x0, y0, c);
+            if (x0 == x1 && y0 == y1) break;
+            int e2 = 2 * error;
+            if (e2 >= dy) {
+                error += dy;
+                x0 += sx;
+            }
+            if (e2 <= dx) {
+                error += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    void Strip::drawText(const Font& font, std::string_view text, int x, int y, SDL_Color c) {
+        int penX = x;
+        for (char ch : text) {
+            const SDL_Surface* glyph = font.surface(ch);
+            if (glyph && penX < right && penX + glyph->w > left) {
+                for (int row = 0; row < glyph->h; row++) {
+                    const Uint32* source = reinterpret_cast<const Uint32*>(
+                        static_cast<const uint8_t*>(glyph->pixels) + static_cast<size_t>(row) * glyph->pitch);
+                    for (int col = 0; col < glyph->w; col++) {
+                        blend(penX + col, y + row, c, static_cast<int>(source[col] >> 24));
+                    }
+                }
+            }
+            penX += font.advance(ch);
+        }
+    }
+
+    void Strip::coverSegment(float x0, float y0, float x1, float y1, float lineWidth) {
+        const float inner = std::max(lineWidth, 1.0f) / 2.0f - 0.5f;
+        const float outer = inner + 1.0f;
+        const float alpha = std::min(lineWidth, 1.0f);
+
+        int boxLeft = std::max(left, static_cast<int>(std::floor(std::min(x0, x1) - outer)));
+        int boxRight = std::min(right, static_cast<int>(std::ceil(std::max(x0, x1) + outer)) + 1);
+        int boxTop = std::max(0, static_cast<int>(std::floor(std::min(y0, y1) - outer)));
+        int boxBottom = std::min(height, static_cast<int>(std::ceil(std::max(y0, y1) + outer)) + 1);
+        if (boxLeft >= boxRight || boxTop >= boxBottom) return;
+
+        if (coverage.empty()) coverage.assign(static_cast<size_t>(right - left) * height, 0);
+        coveredLeft = std::min(coveredLeft, boxLeft);
+        coveredRight = std::max(coveredRight, boxRight);
+        coveredTop = std::min(coveredTop, boxTop);
+        coveredBottom = std::max(coveredBottom, boxBottom);
+
+        float dx = x1 - x0, dy = y1 - y0;
+        float lengthSquared = dx * dx + dy * dy;
+        for (int y = boxTop; y < boxBottom; y++) {
+            uint8_t* row = coverage.data() + static_cast<size_t>(y) * (right - left) - left;
+            for (int x = boxLeft; x < boxRight; x++) {
+                float px = x + 0.5f - x0, py = y + 0.5f - y0;
+                float t = lengthSquared > 0.0f ? std::clamp((px * dx + py * dy) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+                float ex = px - t * dx, ey = py - t * dy;
+                float distance = std::sqrt(ex * ex + ey * ey);
+                float cover = std::clamp(outer - distance, 0.0f, 1.0f) * alpha;
+                uint8_t value = static_cast<uint8_t>(cover * 255.0f + 0.5f);
+                row[x] = std::max(row[x], value);
+            }
+        }
+    }
+
+    void Strip::fillCoverage(SDL_Color c) {
+        for (int y = coveredTop; y < coveredBottom; y++) {
+            uint8_t* row = coverage.data() + static_cast<size_t>(y) * (right - left) - left;
+            for (int x = coveredLeft; x < coveredRight; x++) {
+                blend(x, y, c, row[x] * c.a / 255);
+                row[x] = 0;
+            }
+        }
+        coveredLeft = right;
+        coveredRight = left;
+        coveredTop = height;
+        coveredBottom = 0;
+    }
+
+    static size_t renderStrip(Strip& strip, int width, int height,
+        double minX, double maxX, double minY, double maxY,
+        const std::vector<graph::Segment>& segments, const std::vector<graph::Label>& labels,
+        const std::vector<Curve>& curves, const Font* font, float lineWidth,
+        const tasks::Cancellation& cancellation, std::atomic<tasks::Status>& stopped) {
+        tracing::Span span("renderStrip");
+
+        strip.clear({ 0, 0, 0, 255 });
+        for (const graph::Segment& s : segments) {
+            strip.drawLine(s.x0, s.y0, s.x1, s.y1, s.color);
+        }
+        if (font && font->ready()) {
+            const SDL_Color textColor = { 255, 255, 255, 255 };
+            for (const graph::Label& label : labels) {
+                int labelWidth = font->measure(label.view());
+                if (label.anchor == graph::Label::Anchor::Top) {
+                    strip.drawText(*font, label.view(), label.x - labelWidth / 2, label.y, textColor);
+                }
+                else {
+                    strip.drawText(*font, label.view(), label.x - labelWidth, label.y - font->lineHeight() / 2, textColor);
+                }
+            }
+        }
+
+        // the margin covers segments that end just outside the strip but reach into it
+        const int margin = static_cast<int>(std::ceil(std::max(lineWidth, 1.0f) / 2.0f + 0.5f)) + 1;
+        const int64_t first = static_cast<int64_t>(strip.begin() - margin) * SAMPLES_PER_COLUMN;
+        const int64_t last = static_cast<int64_t>(strip.end() + margin) * SAMPLES_PER_COLUMN;
+        const double scaleX = width / (maxX - minX);
+        const double scaleY = -height / (maxY - minY);
+        const double offsetY = height - minY * scaleY;
+
+        std::vector<double> xs, ys;
+        size_t evaluations = 0;
+        for (const Curve& curve : curves) {
+            tasks::Status status = cancellation.status();
+            if (status != tasks::Status::Complete) {
+                stopped = status;
+                break;
+            }
+            evaluations += sampler::sampleColumns(*curve.fn, minX, maxX, minY, maxY,
+                width, height, SAMPLES_PER_COLUMN, first, last, xs, ys);
+
+            for (size_t i = 1; i < xs.size(); i++) {
+                if (!(ys[i - 1] >= minY && ys[i - 1] <= maxY && ys[i] >= minY && ys[i] <= maxY)) continue;
+                if (lineWidth > 0.0f) {
+                    strip.coverSegment(
+                        static_cast<float>((xs[i - 1] - minX) * scaleX), static_cast<float>(ys[i - 1] * scaleY + offsetY),
+                        static_cast<float>((xs[i] - minX) * scaleX), static_cast<float>(ys[i] * scaleY + offsetY),
+                        lineWidth);
+                }
+                else {
+                    strip.drawLine(
+                        static_cast<int>(std::floor((xs[i - 1] - minX) * scaleX)), static_cast<int>(std::floor(ys[i - 1] * scaleY + offsetY)),
+                        static_cast<int>(std::floor((xs[i] - minX) * scaleX)), static_cast<int>(std::floor(ys[i] * scaleY + offsetY)),
+                        curve.color);
+                }
+            }
+            if (lineWidth > 0.0f) strip.fillCoverage(curve.color);
+        }
+        return evaluations;
+    }
+
+    tasks::Status render(uint8_t* pixels, int pitch, int width, int height,
+        double minX, double maxX, double minY, double maxY,
+        const std::vector<Curve>& curves, const Font* font, int strips, float lineWidth,
+        const tasks::Cancellation& cancellation, size_t* evaluations) {
+        tracing::Span span("rasterize");
+
+        std::vector<graph::Segment> segments;
+        std::vector<graph::Label> labels;
+        graph::gridLayout(minX, maxX, minY, maxY, width, height, segments);
+        graph::axesLayout(minX, maxX, minY, maxY, width, height, segments, labels);
+
+        if (strips <= 0) strips = static_cast<int>(tasks::workerCount());
+        strips = std::clamp(width / MIN_STRIP_WIDTH, 1, strips);
+
+        // one curve of one strip is the block checked against the cancellation
+        std::atomic<size_t> used = 0;
+        std::atomic<tasks::Status> stopped = tasks::Status::Complete;
+        tasks::Status status = tasks::parallelFor(strips, tasks::Priority::Background, cancellation, [&](size_t index) {
+            int i = static_cast<int>(index);
+            Strip strip(pixels, pitch, width * i / strips, width * (i + 1) / strips, height);
+            used += renderStrip(strip, width, height, minX, maxX, minY, maxY, segments, labels, curves, font, lineWidth,
+                cancellation, stopped);
+            });
+
+        if (evaluations) *evaluations = used;
+        return status != tasks::Status::Complete ? status : stopped.load();
+    }
+
+}
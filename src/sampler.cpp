@@ -0,0 +1,548 @@
+#include "sampler.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const double TOLERANCE_PX = 0.5;  // allowed deviation of a sample from its neighbours' chord
+    const double STEEP_PX = 16.0;     // vertical span of one interval that always gets split
+    const double MIN_WIDTH_PX = 0.25;
+    const double EDGE_SCORE = 1e9;    // domain and screen edges are refined first
+    const double COLUMN_MIN_WIDTH_PX = 1.0 / 16.0;
+    const double JUMP_PX = 2.0;         // smaller jumps are never treated as discontinuities
+    const double JUMP_RATIO = 4.0;      // how much steeper than its neighbours a segment may be
+    const double CONTINUOUS_SHARE = 0.75;
+    const int MAX_BISECTIONS = 40;
+
+    // A segment is suspicious when it jumps against the direction of both neighbours or far
+    // beyond their slope. before and after are the neighbours' slopes times this segment's width.
+    bool suspicious(double before, double jump, double after, double tolerance) {
+        if (std::abs(jump) <= tolerance) return false;
+        if (!std::isfinite(before)) before = 0.0;
+        if (!std::isfinite(after)) after = 0.0;
+        bool against = before * jump < 0.0 && after * jump < 0.0;
+        bool steeper = std::abs(jump) > JUMP_RATIO * std::max(std::abs(before), std::abs(after));
+        return against || steeper;
+    }
+
+    // Narrows [a, b] onto the jump by keeping the half that holds most of it. A continuous
+    // function splits its rise between the halves, so once neither half keeps most of it the
+    // segment is accepted as continuous and false is returned. Otherwise the jump survives until
+    // the interval cannot be split further and [a, b] brackets the discontinuity. Running out
+    // of spare evaluations first leaves the segment alone.
+    template <typename Position, typename Split, typename Midpoint, typename Sample>
+    bool bracketJump(Position& a, double& ya, Position& b, double& yb, double tolerance,
+        Split splittable, Midpoint midpoint, Sample sample, size_t& spare) {
+        for (int step = 0; step < MAX_BISECTIONS && splittable(a, b); step++) {
+            if (spare == 0) return false;
+            Position m = midpoint(a, b);
+            double ym = sample(m);
+            spare--;
+            if (!std::isfinite(ym)) return true;
+
+            double jump = std::abs(yb - ya);
+            double left = std::abs(ym - ya), right = std::abs(yb - ym);
+            if (std::max(left, right) < CONTINUOUS_SHARE * jump) return false;
+            if (left >= right) {
+                b = m;
+                yb = ym;
+            }
+            else {
+                a = m;
+                ya = ym;
+            }
+            if (std::abs(yb - ya) <= tolerance) return false;
+        }
+        return true;
+    }
+}
+
+namespace sampler {
+
+    double evaluate(const Function& fn, double x) {
+        try {
+            return static_cast<double>(fn(x));
+        }
+        catch (...) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    size_t SampleCache::TileKeyHash::operator()(const TileKey& key) const {
+        size_t h = std::hash<int64_t>()(key.index);
+        h ^= (static_cast<size_t>(key.slot) * 131 + static_cast<size_t>(key.exponent + 4096)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    SampleCache::SampleCache(size_t capacityBytes) : capacity(capacityBytes) {}
+
+    SampleCache::TileKey SampleCache::locate(int slot, int exponent, int64_t key, int& offset) {
+        if (key == 0) {
+            offset = 0;
+            return { slot, std::numeric_limits<int>::min(), 0 };
+        }
+
+        int zeros = std::countr_zero(static_cast<uint64_t>(key < 0 ? -key : key));
+        key >>= zeros;
+        exponent += zeros;
+
+        // odd keys map one to one onto consecutive integers
+        int64_t index = key >> 1;
+        offset = static_cast<int>(index & ((1 << TILE_BITS) - 1));
+        return { slot, exponent, index >> TILE_BITS };
+    }
+
+    void SampleCache::touch(Tile& tile) {
+        if (tile.use != lru.begin()) {
+            lru.splice(lru.begin(), lru, tile.use);
+        }
+    }
+
+    void SampleCache::evict() {
+        while (bytes() > capacity && lru.size() > 1) {
+            tiles.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+
+    void SampleCache::setRevision(int slot, uint64_t revision) {
+        auto it = revisions.find(slot);
+        if (it != revisions.end() && it->second == revision) return;
+        revisions[slot] = revision;
+
+        for (auto tile = tiles.begin(); tile != tiles.end();) {
+            if (tile->first.slot == slot) {
+                lru.erase(tile->second.use);
+                tile = tiles.erase(tile);
+            }
+            else {
+                ++tile;
+            }
+        }
+    }
+
+    bool SampleCache::lookup(int slot, int exponent, int64_t key, double& y) {
+        int offset;
+        auto it = tiles.find(locate(slot, exponent, key, offset));
+        if (it == tiles.end() || !(it->second.present & (uint64_t(1) << offset))) return false;
+        touch(it->second);
+        y = it->second.values[offset];
+        return true;
+    }
+
+    void SampleCache::store(int slot, int exponent, int64_t key, double y) {
+        int offset;
+        TileKey tileKey = locate(slot, exponent, key, offset);
+        auto [it, inserted] = tiles.try_emplace(tileKey);
+        Tile& tile = it->second;
+        if (inserted) {
+            lru.push_front(tileKey);
+            tile.use = lru.begin();
+        }
+        else {
+            touch(tile);
+        }
+        tile.values[offset] = y;
+        tile.present |= uint64_t(1) << offset;
+
+        if (inserted) evict();
+    }
+
+    size_t SampleCache::bytes() const {
+        return tiles.size() * TILE_BYTES;
+    }
+
+    size_t SampleCache::tileCount() const {
+        return tiles.size();
+    }
+
+    double AdaptiveSampler::toX(int64_t key) const {
+        return origin + std::ldexp(static_cast<double>(key), fineExponent);
+    }
+
+    double AdaptiveSampler::sample(int64_t key) {
+        double y;
+        if (cache && cache->lookup(slot, fineExponent, key, y)) return y;
+        y = evaluate(*fn, toX(key));
+        used++;
+        if (cache) cache->store(slot, fineExponent, key, y);
+        return y;
+    }
+
+    bool AdaptiveSampler::matches(double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight) const {
+        return fn && this->minX == minX && this->maxX == maxX && this->minY == minY && this->maxY == maxY
+            && this->screenWidth == screenWidth && this->screenHeight == screenHeight;
+    }
+
+    size_t AdaptiveSampler::start(const Function& fn,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, size_t budget,
+        SampleCache* cache, int slot) {
+        tracing::Span span("samplerStart");
+
+        this->fn = &fn;
+        this->cache = cache;
+        this->slot = slot;
+        this->minX = minX;
+        this->maxX = maxX;
+        this->minY = minY;
+        this->maxY = maxY;
+        this->screenWidth = screenWidth;
+        this->screenHeight = screenHeight;
+        this->budget = budget;
+        pxPerX = screenWidth / (maxX - minX);
+        pxPerY = screenHeight / (maxY - minY);
+        used = 0;
+        stage = Stage::Refining;
+
+        const int coarse = std::max(8, screenWidth / 8);
+
+        // a power-of-two spacing stays the same across pans and for several zoom steps,
+        // and keys are counted in fine units of spacing / 2^FINE_BITS from x = 0
+        const int level = static_cast<int>(std::floor(std::log2((maxX - minX) / coarse)));
+        const double spacing = std::ldexp(1.0, level);
+        fineExponent = level - SampleCache::FINE_BITS;
+        const int64_t unit = int64_t(1) << SampleCache::FINE_BITS;
+
+        // Far out and zoomed in, keys counted from x = 0 no longer fit in 64 bits. Keys are then
+        // counted from the view's first grid point instead, which the cache cannot share.
+        const double limit = std::ldexp(1.0, 62 - SampleCache::FINE_BITS);
+        origin = 0.0;
+        if (!(std::abs(minX / spacing) < limit && std::abs(maxX / spacing) < limit)) {
+            origin = std::floor(minX / spacing) * spacing;
+            this->cache = nullptr;
+        }
+        const int64_t first = static_cast<int64_t>(std::floor((minX - origin) / spacing));
+        const int64_t last = static_cast<int64_t>(std::ceil((maxX - origin) / spacing));
+
+        keys.clear();
+        xs.clear();
+        ys.clear();
+        resume.clear();
+        for (int64_t k = first; k <= last; k++) {
+            int64_t key = k * unit;
+            keys.push_back(key);
+            xs.push_back(toX(key));
+            ys.push_back(sample(key));
+        }
+        points = xs.size();
+
+        return used;
+    }
+
+    bool AdaptiveSampler::flag(size_t refineBudget) {
+        auto inRange = [&](double y) { return y >= minY && y <= maxY; };
+        auto splittable = [&](size_t i) {
+            return keys[i + 1] - keys[i] >= 2 && (xs[i + 1] - xs[i]) * pxPerX >= MIN_WIDTH_PX;
+            };
+
+        size_t intervals = xs.size() - 1;
+        scores.assign(intervals, 0.0);
+
+        for (size_t i = 0; i < intervals; i++) {
+            if (!splittable(i)) continue;
+
+            bool finite0 = std::isfinite(ys[i]), finite1 = std::isfinite(ys[i + 1]);
+            if (finite0 != finite1 || inRange(ys[i]) != inRange(ys[i + 1])) {
+                scores[i] = EDGE_SCORE;
+                continue;
+            }
+            if (!finite0) continue;
+            if ((ys[i] > maxY && ys[i + 1] > maxY) || (ys[i] < minY && ys[i + 1] < minY)) continue;
+
+            double spanPx = std::abs(ys[i + 1] - ys[i]) * pxPerY;
+            if (spanPx > STEEP_PX) scores[i] = spanPx;
+        }
+
+        for (size_t i = 1; i < intervals; i++) {
+            if (!std::isfinite(ys[i - 1]) || !std::isfinite(ys[i]) || !std::isfinite(ys[i + 1])) continue;
+            double t = (xs[i] - xs[i - 1]) / (xs[i + 1] - xs[i - 1]);
+            double chord = ys[i - 1] + (ys[i + 1] - ys[i - 1]) * t;
+            double deviationPx = std::abs(ys[i] - chord) * pxPerY;
+            if (deviationPx > TOLERANCE_PX) {
+                if (splittable(i - 1)) scores[i - 1] = std::max(scores[i - 1], deviationPx);
+                if (splittable(i)) scores[i] = std::max(scores[i], deviationPx);
+            }
+        }
+
+        flagged.clear();
+        for (size_t i = 0; i < intervals; i++) {
+            if (scores[i] > 0.0) flagged.push_back(i);
+        }
+        if (flagged.empty()) return false;
+
+        size_t remaining = refineBudget - points;
+        if (flagged.size() > remaining) {
+            std::nth_element(flagged.begin(), flagged.begin() + remaining, flagged.end(),
+                [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+            flagged.resize(remaining);
+            std::sort(flagged.begin(), flagged.end());
+        }
+        return true;
+    }
+
+    bool AdaptiveSampler::refinePass(const tasks::Cancellation& cancellation, size_t refineBudget) {
+        size_t intervals = xs.size() - 1;
+
+        // an interrupted pass is finished first, rescoring would let the timing pick the splits
+        if (!resume.empty()) {
+            flagged.swap(resume);
+            resume.clear();
+        }
+        else if (!flag(refineBudget)) {
+            return false;
+        }
+
+        // once cancelled or past the evaluation limit the rest of the flagged intervals wait for the next pass
+        nextKeys.clear();
+        nextXs.clear();
+        nextYs.clear();
+        size_t f = 0, split = 0;
+        bool expired = false;
+        for (size_t i = 0; i <= intervals; i++) {
+            nextKeys.push_back(keys[i]);
+            nextXs.push_back(xs[i]);
+            nextYs.push_back(ys[i]);
+            if (f < flagged.size() && flagged[f] == i) {
+                f++;
+                if (expired || used >= allowance || ((split & 15) == 15 && cancellation.status() != tasks::Status::Complete)) {
+                    expired = true;
+                    resume.push_back(i + split);
+                    continue;
+                }
+                int64_t mid = keys[i] + (keys[i + 1] - keys[i]) / 2;
+                nextKeys.push_back(mid);
+                nextXs.push_back(toX(mid));
+                nextYs.push_back(sample(mid));
+                split++;
+            }
+        }
+        points += split;
+        keys.swap(nextKeys);
+        xs.swap(nextXs);
+        ys.swap(nextYs);
+        return true;
+    }
+
+    void AdaptiveSampler::markBreaks() {
+        auto inRange = [&](double y) { return y >= minY && y <= maxY; };
+
+        // Poles and jumps whose sides both land on screen would otherwise be joined by a near
+        // vertical line. Suspicious segments are bisected, confirmed breaks keep their bracket
+        // and get a NaN between so every renderer splits the curve there.
+        size_t spare = budget > points ? budget - points : 0;
+        const double tolerance = JUMP_PX / pxPerY;
+        const size_t count = xs.size();
+        auto sampleKey = [&](int64_t key) { return sample(key); };
+        nextXs.clear();
+        nextYs.clear();
+        for (size_t i = 0; i < count; i++) {
+            nextXs.push_back(xs[i]);
+            nextYs.push_back(ys[i]);
+            if (i + 1 == count || !inRange(ys[i]) || !inRange(ys[i + 1])) continue;
+
+            double width = xs[i + 1] - xs[i];
+            double before = i > 0 ? (ys[i] - ys[i - 1]) / (xs[i] - xs[i - 1]) * width : 0.0;
+            double after = i + 2 < count ? (ys[i + 2] - ys[i + 1]) / (xs[i + 2] - xs[i + 1]) * width : 0.0;
+            if (!suspicious(before, ys[i + 1] - ys[i], after, tolerance)) continue;
+
+            int64_t a = keys[i], b = keys[i + 1];
+            double ya = ys[i], yb = ys[i + 1];
+            bool broken = bracketJump(a, ya, b, yb, tolerance,
+                [](int64_t a, int64_t b) { return b - a >= 2; },
+                [](int64_t a, int64_t b) { return a + (b - a) / 2; },
+                sampleKey, spare);
+            if (!broken) continue;
+
+            double xa = toX(a);
+            double xb = toX(b);
+            if (a != keys[i]) {
+                nextXs.push_back(xa);
+                nextYs.push_back(ya);
+            }
+            nextXs.push_back(xa + (xb - xa) / 2);
+            nextYs.push_back(std::numeric_limits<double>::quiet_NaN());
+            if (b != keys[i + 1]) {
+                nextXs.push_back(xb);
+                nextYs.push_back(yb);
+            }
+        }
+        xs.swap(nextXs);
+        ys.swap(nextYs);
+    }
+
+    size_t AdaptiveSampler::refine(const tasks::Cancellation& cancellation, size_t maxEvaluations) {
+        if (stage == Stage::Done) return 0;
+        tracing::Span span("samplerRefine");
+        used = 0;
+        allowance = maxEvaluations;
+
+        // an eighth of the budget is kept for locating discontinuities
+        const size_t refineBudget = budget - budget / 8;
+
+        while (stage == Stage::Refining) {
+            if (used >= allowance || cancellation.status() != tasks::Status::Complete) return used;
+            if (points >= refineBudget || !refinePass(cancellation, refineBudget)) {
+                stage = Stage::Breaks;
+            }
+        }
+
+        if (used >= allowance || cancellation.status() != tasks::Status::Complete) return used;
+        markBreaks();
+        stage = Stage::Done;
+        return used;
+    }
+
+    bool AdaptiveSampler::done() const {
+        return stage == Stage::Done;
+    }
+
+    const std::vector<double>& AdaptiveSampler::sampleXs() const {
+        return xs;
+    }
+
+    const std::vector<double>& AdaptiveSampler::sampleYs() const {
+        return ys;
+    }
+
+    size_t sampleAdaptive(const Function& fn,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, size_t budget,
+        std::vector<double>& xs, std::vector<double>& ys,
+        SampleCache* cache, int slot) {
+        tracing::Span span("sampleAdaptive");
+
+        thread_local AdaptiveSampler sampler;
+        size_t used = sampler.start(fn, minX, maxX, minY, maxY, screenWidth, screenHeight, budget, cache, slot);
+        used += sampler.refine(tasks::Cancellation());
+        xs.assign(sampler.sampleXs().begin(), sampler.sampleXs().end());
+        ys.assign(sampler.sampleYs().begin(), sampler.sampleYs().end());
+        return used;
+    }
+
+    size_t sampleColumns(const Function& fn,
+        double minX, double maxX, double minY, double maxY,
+        int screenWidth, int screenHeight, int samplesPerColumn,
+        int64_t first, int64_t last,
+        std::vector<double>& xs, std::vector<double>& ys) {
+        tracing::Span span("sampleColumns");
+
+        const int64_t count = static_cast<int64_t>(screenWidth) * samplesPerColumn;
+        const double step = (maxX - minX) / count;
+        const double pxPerX = screenWidth / (maxX - minX);
+        const double pxPerY = screenHeight / (maxY - minY);
+        first = std::max<int64_t>(first, 0);
+        last = std::min(last, count);
+
+        size_t used = 0;
+        auto inRange = [&](double y) { return y >= minY && y <= maxY; };
+        auto refine = [&](auto& self, double x0, double y0, double x1, double y1) -> void {
+            if ((x1 - x0) * pxPerX < COLUMN_MIN_WIDTH_PX) return;
+            bool finite0 = std::isfinite(y0), finite1 = std::isfinite(y1);
+            bool edge = finite0 != finite1 || inRange(y0) != inRange(y1);
+            bool offscreen = (y0 > maxY && y1 > maxY) || (y0 < minY && y1 < minY);
+            bool steep = finite0 && finite1 && !offscreen && std::abs(y1 - y0) * pxPerY > STEEP_PX;
+            if (!edge && !steep) return;
+
+            double xm = x0 + (x1 - x0) / 2;
+            double ym = evaluate(fn, xm);
+            used++;
+            self(self, x0, y0, xm, ym);
+            xs.push_back(xm);
+            ys.push_back(ym);
+            self(self, xm, ym, x1, y1);
+            };
+
+        // one grid point either side gives every interval both neighbours for the jump test
+        thread_local std::vector<double> grid;
+        grid.clear();
+        for (int64_t i = first - 1; i <= last + 1; i++) {
+            grid.push_back(evaluate(fn, minX + i * step));
+            used++;
+        }
+        auto gridY = [&](int64_t i) { return grid[static_cast<size_t>(i - first + 1)]; };
+
+        const double tolerance = JUMP_PX / pxPerY;
+        auto splittable = [&](double a, double b) { return (b - a) * pxPerX >= COLUMN_MIN_WIDTH_PX / 1024; };
+        auto midpoint = [](double a, double b) { return a + (b - a) / 2; };
+        auto sample = [&](double x) { used++; return evaluate(fn, x); };
+
+        xs.clear();
+        ys.clear();
+        for (int64_t i = first; i <= last; i++) {
+            double x = minX + i * step;
+            double y = gridY(i);
+            if (i > first) {
+                double previousX = minX + (i - 1) * step;
+                double previousY = gridY(i - 1);
+                double a = previousX, ya = previousY, b = x, yb = y;
+                size_t spare = MAX_BISECTIONS;
+                bool broken = inRange(previousY) && inRange(y)
+                    && suspicious(previousY - gridY(i - 2), y - previousY, gridY(i + 1) - y, tolerance)
+                    && bracketJump(a, ya, b, yb, tolerance, splittable, midpoint, sample, spare);
+
+                if (broken) {
+                    refine(refine, previousX, previousY, a, ya);
+                    if (a != previousX) {
+                        xs.push_back(a);
+                        ys.push_back(ya);
+                    }
+                    xs.push_back(a + (b - a) / 2);
+                    ys.push_back(std::numeric_limits<double>::quiet_NaN());
+                    if (b != x) {
+                        xs.push_back(b);
+                        ys.push_back(yb);
+                    }
+                    refine(refine, b, yb, x, y);
+                }
+                else {
+                    refine(refine, previousX, previousY, x, y);
+                }
+            }
+            xs.push_back(x);
+            ys.push_back(y);
+        }
+
+        return used;
+    }
+
+    size_t sampleEnvelope(const Function& fn, double minX, double maxX,
+        int columns, int samplesPerColumn,
+        std::vector<double>& lows, std::vector<double>& highs) {
+        tracing::Span span("sampleEnvelope");
+
+        const size_t count = static_cast<size_t>(columns) * samplesPerColumn + 1;
+        const double step = (maxX - minX) / (count - 1);
+
+        thread_local std::vector<double> values;
+        values.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            values[i] = evaluate(fn, minX + i * step);
+        }
+
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        lows.assign(columns, nan);
+        highs.assign(columns, nan);
+        for (int c = 0; c < columns; c++) {
+            double low = std::numeric_limits<double>::infinity();
+            double high = -std::numeric_limits<double>::infinity();
+            size_t first = static_cast<size_t>(c) * samplesPerColumn;
+            for (size_t i = first; i <= first + samplesPerColumn; i++) {
+                if (!std::isfinite(values[i])) continue;
+                low = std::min(low, values[i]);
+                high = std::max(high, values[i]);
+            }
+            if (low <= high) {
+                lows[c] = low;
+                highs[c] = high;
+            }
+        }
+
+        return count;
+    }
+
+}
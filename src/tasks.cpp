@@ -0,0 +1,247 @@
+#include "tasks.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tasks {
+
+    namespace {
+        struct Task {
+            std::function<void()> run;
+            Group* group;
+        };
+
+        struct Worker {
+            std::mutex mutex;
+            std::array<std::deque<Task>, 2> queues; // indexed by Priority
+        };
+
+        class Pool {
+        private:
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::vector<std::thread> threads;
+            std::atomic<size_t> queued = 0;
+            std::atomic<size_t> nextWorker = 0;
+            std::mutex sleepMutex;
+            std::condition_variable sleep;
+            bool stopping = false;
+
+            void loop(size_t index);
+        public:
+            explicit Pool(int threads);
+            ~Pool();
+
+            // bumped whenever a group finishes, waiters sleep on it since the group may be gone
+            std::atomic<size_t> completions = 0;
+
+            size_t size() const { return workers.size(); }
+            void push(Task&&, Priority);
+            // with a group, only that group's tasks are taken
+            bool take(Task&, const Group* only = nullptr);
+            void execute(Task&);
+        };
+
+        // index of the pool worker running on this thread, none for every other thread
+        thread_local size_t self = SIZE_MAX;
+
+        int configured = 0;
+        std::once_flag started;
+        std::unique_ptr<Pool> pool;
+
+        Pool& instance() {
+            std::call_once(started, []() { pool = std::make_unique<Pool>(configured); });
+            return *pool;
+        }
+
+        Pool::Pool(int count) {
+            if (count <= 0) count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            for (int i = 0; i < count; i++) {
+                workers.push_back(std::make_unique<Worker>());
+            }
+            for (int i = 0; i < count; i++) {
+                threads.emplace_back(&Pool::loop, this, static_cast<size_t>(i));
+            }
+        }
+
+        Pool::~Pool() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            sleep.notify_all();
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+
+        void Pool::push(Task&& task, Priority priority) {
+            // other threads spread their tasks, workers keep theirs close
+            size_t index = self < workers.size() ? self : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+            {
+                std::lock_guard<std::mutex> lock(workers[index]->mutex);
+                workers[index]->queues[static_cast<size_t>(priority)].push_back(std::move(task));
+            }
+            {
+                // taking the lock orders the increment against a worker about to sleep
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                queued.fetch_add(1, std::memory_order_release);
+            }
+            sleep.notify_one();
+        }
+
+        bool Pool::take(Task& task, const Group* only) {
+            const size_t count = workers.size();
+            auto remove = [&](std::deque<Task>& queue, bool newest) {
+                if (queue.empty()) return false;
+                auto it = newest ? std::prev(queue.end()) : queue.begin();
+                if (only) {
+                    auto matches = [&](const Task& t) { return t.group == only; };
+                    if (newest) {
+                        auto found = std::find_if(queue.rbegin(), queue.rend(), matches);
+                        if (found == queue.rend()) return false;
+                        it = std::prev(found.base());
+                    }
+                    else {
+                        it = std::find_if(queue.begin(), queue.end(), matches);
+                        if (it == queue.end()) return false;
+                    }
+                }
+                task = std::move(*it);
+                queue.erase(it);
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            };
+
+            for (size_t priority = 0; priority < 2; priority++) {
+                if (self < count) {
+                    Worker& own = *workers[self];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (remove(own.queues[priority], true)) return true;
+                }
+                size_t first = self < count ? self + 1 : 0;
+                for (size_t i = 0; i < count; i++) {
+                    size_t victim = (first + i) % count;
+                    if (victim == self) continue;
+                    Worker& other = *workers[victim];
+                    std::lock_guard<std::mutex> lock(other.mutex);
+                    if (remove(other.queues[priority], false)) return true;
+                }
+            }
+            return false;
+        }
+
+        void Pool::execute(Task& task) {
+            Group* group = task.group;
+            task.run();
+            task.run = nullptr;
+            if (group && group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                completions.fetch_add(1, std::memory_order_release);
+                completions.notify_all();
+            }
+        }
+
+        void Pool::loop(size_t index) {
+            self = index;
+            Task task;
+            while (true) {
+                if (take(task)) {
+                    execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleep.wait(lock, [&]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+                if (stopping) return;
+            }
+        }
+    }
+
+    const char* describe(Status status) {
+        switch (status) {
+        case Status::Cancelled: return "cancelled";
+        case Status::TimedOut: return "timed out";
+        default: return "complete";
+        }
+    }
+
+    Status Cancellation::status() const {
+        if (token.cancelled()) return Status::Cancelled;
+        if (deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline) {
+            return Status::TimedOut;
+        }
+        return Status::Complete;
+    }
+
+    void start(int threads) {
+        configured = threads;
+        instance();
+    }
+
+    size_t workerCount() {
+        return instance().size();
+    }
+
+    void submit(std::function<void()> run, Priority priority, Group* group) {
+        if (group) group->pending.fetch_add(1, std::memory_order_relaxed);
+        instance().push({ std::move(run), group }, priority);
+    }
+
+    void wait(Group& group) {
+        tracing::Span span("waitTasks");
+        Pool& p = instance();
+        Task task;
+        while (true) {
+            size_t seen = p.completions.load(std::memory_order_acquire);
+            if (group.pending.load(std::memory_order_acquire) == 0) return;
+            // Only the group's own tasks are helped with. Anything else could be slower or less
+            // urgent work, and the caller may be the UI thread or hold a lock meanwhile.
+            if (p.take(task, &group)) {
+                p.execute(task);
+                continue;
+            }
+            // whatever is left of the group is running elsewhere
+            p.completions.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    Status parallelFor(size_t count, Priority priority, const Cancellation& cancellation,
+        const std::function<void(size_t)>& body) {
+        Group group;
+        std::atomic<Status> skipped = Status::Complete;
+        std::atomic<bool> failed = false;
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        for (size_t i = 0; i < count; i++) {
+            submit([&, i]() {
+                if (failed) return;
+                Status status = cancellation.status();
+                if (status != Status::Complete) {
+                    skipped = status;
+                    return;
+                }
+                try {
+                    body(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                    failed = true;
+                }
+                }, priority, &group);
+        }
+        wait(group);
+
+        if (error) std::rethrow_exception(error);
+        return skipped;
+    }
+
+}
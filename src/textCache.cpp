@@ -0,0 +1,106 @@
+#include "textCache.hpp"
+#include "tracing.hpp"
+
+#include <functional>
+
+size_t TextCache::KeyHash::operator()(const KeyView& key) const {
+	size_t h = std::hash<std::string_view>()(key.text);
+	h ^= (static_cast<size_t>(key.color) * 31 + static_cast<size_t>(key.size)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	return h;
+}
+
+TextCache::TextCache(SDL_Renderer* renderer, TextRenderer& text, size_t capacityBytes)
+	: renderer(renderer), text(text), capacity(capacityBytes) {}
+
+TextCache::~TextCache() {
+	release();
+}
+
+void TextCache::release() {
+	for (Entry& entry : entries) {
+		if (entry.texture) SDL_DestroyTexture(entry.texture);
+	}
+	entries.clear();
+	index.clear();
+	used = 0;
+}
+
+const TextCache::Entry* TextCache::render(const KeyView& key, SDL_Color color) {
+	tracing::Span span("cacheText");
+
+	int w = text.measure(key.text, key.size);
+	int h = text.lineHeight(key.size);
+	if (w <= 0 || h <= 0) return nullptr;
+
+	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+	if (!texture) return nullptr;
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	// quads still batched for the current target must not end up in the cached texture
+	text.flush();
+
+	// clearing to the text color with zero alpha keeps the blended edges unpremultiplied
+	SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+	SDL_SetRenderTarget(renderer, texture);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 0);
+	SDL_RenderClear(renderer);
+	text.draw(key.text, 0, 0, key.size, { color.r, color.g, color.b, 255 });
+	text.flush();
+	SDL_SetRenderTarget(renderer, previousTarget);
+
+	size_t bytes = static_cast<size_t>(w) * h * 4;
+	entries.push_front({ { std::string(key.text), key.size, key.color }, texture, w, h, bytes });
+	index.emplace(entries.front().key, entries.begin());
+	used += bytes;
+	evict();
+
+	return &entries.front();
+}
+
+void TextCache::evict() {
+	// the front entry was just used, so it is never evicted
+	while (used > capacity && entries.size() > 1) {
+		Entry& victim = entries.back();
+		used -= victim.bytes;
+		index.erase(victim.key);
+		SDL_DestroyTexture(victim.texture);
+		entries.pop_back();
+	}
+}
+
+int TextCache::draw(std::string_view str, int x, int y, int size, SDL_Color color) {
+	if (str.empty()) return 0;
+
+	if (!SDL_RenderTargetSupported(renderer)) {
+		text.draw(str, x, y, size, color);
+		text.flush();
+		return text.measure(str, size);
+	}
+
+	KeyView key = { str, size, (Uint32(color.r) << 24) | (Uint32(color.g) << 16) | (Uint32(color.b) << 8) | color.a };
+
+	const Entry* entry;
+	auto it = index.find(key);
+	if (it != index.end()) {
+		entries.splice(entries.begin(), entries, it->second);
+		entry = &entries.front();
+	}
+	else {
+		entry = render(key, color);
+		if (!entry) return 0;
+	}
+
+	SDL_SetTextureAlphaMod(entry->texture, color.a);
+	SDL_Rect dest = { x, y, entry->w, entry->h };
+	SDL_RenderCopy(renderer, entry->texture, NULL, &dest);
+	return entry->w;
+}
+
+size_t TextCache::bytes() const {
+	return used;
+}
+
+size_t TextCache::size() const {
+	return entries.size();
+}
@@ -0,0 +1,148 @@
+#include "textRenderer.hpp"
+#include "tracing.hpp"
+
+#include <algorithm>
+
+TextRenderer::TextRenderer(SDL_Renderer* renderer, std::string fontPath) : renderer(renderer), fontPath(fontPath) {}
+
+TextRenderer::~TextRenderer() {
+	release();
+}
+
+void TextRenderer::release() {
+	for (auto& pair : atlases) {
+		if (pair.second.texture) SDL_DestroyTexture(pair.second.texture);
+		if (pair.second.font) TTF_CloseFont(pair.second.font);
+	}
+	atlases.clear();
+	vertices.clear();
+	indices.clear();
+	batchTexture = nullptr;
+}
+
+TextRenderer::Atlas* TextRenderer::atlas(int size) {
+	auto it = atlases.find(size);
+	if (it != atlases.end()) {
+		return it->second.texture ? &it->second : nullptr;
+	}
+
+	tracing::Span span("buildAtlas");
+
+	// failed loads stay in the map so a missing font is not reopened every frame
+	Atlas& a = atlases[size];
+	a.font = TTF_OpenFont(fontPath.c_str(), size);
+	if (!a.font) return nullptr;
+	a.lineHeight = TTF_FontHeight(a.font);
+
+	const int ATLAS_WIDTH = 512;
+	const SDL_Color white = { 255, 255, 255, 255 };
+	std::array<SDL_Surface*, LAST_GLYPH - FIRST_GLYPH + 1> surfaces{};
+	int x = 0, y = 0, rowHeight = 0;
+
+	for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+		Glyph& g = a.glyphs[c - FIRST_GLYPH];
+		TTF_GlyphMetrics(a.font, c, nullptr, nullptr, nullptr, nullptr, &g.advance);
+
+		SDL_Surface* surface = TTF_RenderGlyph_Blended(a.font, c, white);
+		if (surface) {
+			if (x + surface->w > ATLAS_WIDTH) {
+				x = 0;
+				y += rowHeight + 1;
+				rowHeight = 0;
+			}
+			g.src = { x, y, surface->w, surface->h };
+			x += surface->w + 1;
+			rowHeight = std::max(rowHeight, surface->h);
+		}
+		surfaces[c - FIRST_GLYPH] = surface;
+	}
+
+	a.width = ATLAS_WIDTH;
+	a.height = y + rowHeight;
+
+	SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, a.width, a.height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (sheet) {
+		SDL_FillRect(sheet, NULL, 0);
+		for (size_t i = 0; i < surfaces.size(); i++) {
+			if (!surfaces[i]) continue;
+			SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+			SDL_Rect dest = a.glyphs[i].src;
+			SDL_BlitSurface(surfaces[i], NULL, sheet, &dest);
+		}
+		a.texture = SDL_CreateTextureFromSurface(renderer, sheet);
+		if (a.texture) SDL_SetTextureBlendMode(a.texture, SDL_BLENDMODE_BLEND);
+		SDL_FreeSurface(sheet);
+	}
+
+	for (SDL_Surface* surface : surfaces) {
+		if (surface) SDL_FreeSurface(surface);
+	}
+
+	return a.texture ? &a : nullptr;
+}
+
+const TextRenderer::Glyph* TextRenderer::glyph(const Atlas& a, char c) const {
+	if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+	return &a.glyphs[c - FIRST_GLYPH];
+}
+
+bool TextRenderer::ready(int size) {
+	return atlas(size) != nullptr;
+}
+
+int TextRenderer::lineHeight(int size) {
+	Atlas* a = atlas(size);
+	return a ? a->lineHeight : 0;
+}
+
+int TextRenderer::measure(std::string_view text, int size) {
+	Atlas* a = atlas(size);
+	if (!a) return 0;
+	int width = 0;
+	for (char c : text) {
+		width += glyph(*a, c)->advance;
+	}
+	return width;
+}
+
+void TextRenderer::draw(std::string_view text, int x, int y, int size, SDL_Color color) {
+	Atlas* a = atlas(size);
+	if (!a) return;
+
+	if (batchTexture != a->texture) {
+		flush();
+		batchTexture = a->texture;
+	}
+
+	float penX = static_cast<float>(x);
+	float top = static_cast<float>(y);
+	float texW = static_cast<float>(a->width);
+	float texH = static_cast<float>(a->height);
+
+	for (char c : text) {
+		const Glyph* g = glyph(*a, c);
+		if (g->src.w > 0 && g->src.h > 0) {
+			float u0 = g->src.x / texW, u1 = (g->src.x + g->src.w) / texW;
+			float v0 = g->src.y / texH, v1 = (g->src.y + g->src.h) / texH;
+			float right = penX + g->src.w, bottom = top + g->src.h;
+
+			int base = static_cast<int>(vertices.size());
+			vertices.push_back({ { penX, top }, color, { u0, v0 } });
+			vertices.push_back({ { right, top }, color, { u1, v0 } });
+			vertices.push_back({ { right, bottom }, color, { u1, v1 } });
+			vertices.push_back({ { penX, bottom }, color, { u0, v1 } });
+
+			indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+		}
+		penX += g->advance;
+	}
+}
+
+void TextRenderer::flush() {
+	if (vertices.empty() || !batchTexture) return;
+	SDL_RenderGeometry(renderer, batchTexture,
+		vertices.data(), static_cast<int>(vertices.size()),
+		indices.data(), static_cast<int>(indices.size()));
+	vertices.clear();
+	indices.clear();
+}
@@ -0,0 +1,113 @@
+#include "tracing.hpp"
+#include "fileHandler.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+namespace {
+    constexpr size_t CAPACITY = 1 << 16; // events kept per thread, oldest are overwritten
+
+    struct Event {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct ThreadBuffer {
+        uint32_t tid;
+        std::thread::id thread;
+        std::vector<Event> events;
+        size_t head = 0;
+        size_t size = 0;
+        std::mutex mutex;
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::string outputPath;
+    std::thread::id mainThread; // the thread that called start()
+    const auto epoch = std::chrono::steady_clock::now();
+
+    ThreadBuffer& localBuffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = []() {
+            auto b = std::make_shared<ThreadBuffer>();
+            b->events.resize(CAPACITY);
+            std::lock_guard<std::mutex> lock(registryMutex);
+            b->tid = static_cast<uint32_t>(buffers.size() + 1);
+            b->thread = std::this_thread::get_id();
+            buffers.push_back(b);
+            return b;
+            }();
+        return *buffer;
+    }
+}
+
+namespace tracing {
+
+    uint64_t detail::now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void detail::record(const char* name, uint64_t begin, uint64_t end) {
+        ThreadBuffer& b = localBuffer();
+        std::lock_guard<std::mutex> lock(b.mutex);
+        b.events[b.head] = { name, begin, end };
+        b.head = (b.head + 1) % CAPACITY;
+        if (b.size < CAPACITY) b.size++;
+    }
+
+    void start(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            outputPath = path;
+            mainThread = std::this_thread::get_id();
+        }
+        detail::active.store(true, std::memory_order_relaxed);
+    }
+
+    bool flush() {
+        std::vector<std::string> lines;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (outputPath.empty()) return false;
+            path = outputPath;
+
+            // buffers are numbered by first span, which need not be the main thread's
+            lines.push_back("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            size_t workers = 0;
+            for (auto& b : buffers) {
+                std::lock_guard<std::mutex> bufferLock(b->mutex);
+                lines.push_back(fmt::format(
+                    "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},",
+                    b->tid, b->thread == mainThread ? "main" : fmt::format("worker {}", ++workers)));
+
+                size_t first = (b->head + CAPACITY - b->size) % CAPACITY;
+                for (size_t i = 0; i < b->size; i++) {
+                    const Event& e = b->events[(first + i) % CAPACITY];
+                    lines.push_back(fmt::format(
+                        "{{\"name\":\"{}\",\"cat\":\"calc\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},",
+                        e.name, b->tid, e.begin / 1000.0, (e.end - e.begin) / 1000.0));
+                }
+            }
+        }
+
+        // trailing commas are not valid JSON
+        if (lines.size() > 1) lines.back().pop_back();
+        lines.push_back("]}");
+
+        fileHandler::saveFile(lines, path);
+        return true;
+    }
+
+    void stop() {
+        if (!enabled()) return;
+        detail::active.store(false, std::memory_order_relaxed);
+        flush();
+    }
+
+}